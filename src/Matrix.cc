@@ -20,55 +20,99 @@
 */
 
 #include "Matrix.hh"
+#include "arena.hh"
 
 
-Matrix::Matrix (int r, int c)
+template<typename T>
+Matrix<T>::Matrix (int r, int c)
 {
   krows = r;
   kcols = c;
-  vals = new vector<complex<double>>(r * c);
+  vals = arenaArray<T> (r * c);
+  for (int i = 0; i < r * c; i++) vals[i] = 0.0;
 }
 
-Matrix::~Matrix ()
+template<typename T>
+Matrix<T>::Matrix (int r, int c, T *storage)
 {
-  delete vals;
+  krows = r;
+  kcols = c;
+  vals = storage;
+}
+
+template<typename T>
+Matrix<T>::~Matrix ()
+{
+}
+
+template<typename T> void *
+Matrix<T>::operator new (size_t bytes)
+{
+  return Arena::alloc (bytes);
+}
+
+template<typename T> T
+Matrix<T>::val (int r, int c)
+{
+  return vals[c + r * kcols];
 }
 
-complex<double>
-Matrix::val (int r, int c)
+template<typename T> void
+Matrix<T>::val (int r, int c, T v)
 {
-  complex<double>rc (0.0, 0.0);
-  rc = (*vals)[c + r * kcols];
-  return rc;
+  vals[c + r * kcols] = v;
 }
 
-void
-Matrix::val (int r, int c, complex<double> v)
+template<typename T> T *
+Matrix<T>::data ()
 {
-  (*vals)[c + r * kcols] = v;
+  return vals;
 }
 
-int
-Matrix::rows ()
+template<typename T> T *
+Matrix<T>::row (int r)
+{
+  return vals + r * kcols;
+}
+
+template<typename T> int
+Matrix<T>::rows ()
 {
   return krows;
 }
 
-int
-Matrix::cols ()
+template<typename T> int
+Matrix<T>::cols ()
 {
   return kcols;
 }
 
-void
-Matrix::show ()
+template<> bool
+Matrix<double>::is_real ()
+{
+  return true;
+}
+
+template<> bool
+Matrix<complex<double>>::is_real ()
+{
+  for (int i = 0; i < krows * kcols; i++)
+    if (vals[i].imag () != 0.0) return false;
+  return true;
+}
+
+template<typename T> void
+Matrix<T>::show ()
 {
   for (int r = 0; r < krows; r++) {
     for (int c = 0; c < kcols; c++) {
       fprintf (stderr, "%gj%g ",
-	       this->val (r, c).real (),
-	       this->val (r, c).imag ());
+	       real (this->val (r, c)),
+	       imag (this->val (r, c)));
     }
     fprintf (stderr, "\n");
   }
 }
+
+template class Matrix<double>;
+template class Matrix<complex<double>>;
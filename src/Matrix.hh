@@ -30,23 +30,48 @@
 
 using namespace std;
 
+/***
+    Matrices are scratch within a single mtx call, so both the object and
+    its elements live in the call's Arena and are never freed individually.
+    A Matrix can also be laid over storage that's already there, in which
+    case it's used as is.
+    Matrix<double> is used whenever the argument has no complex cells, at
+    half the space and a quarter of the multiply cost of
+    Matrix<complex<double>>.
+ ***/
+
+template<typename T>
 class Matrix
 {
 public:
   Matrix (int r, int c);
+  Matrix (int r, int c, T *storage);
   ~Matrix ();
-  complex<double> val (int r, int c);
-  void val (int r, int c, complex<double> v);
+  static void *operator new (size_t bytes);
+  static void  operator delete (void *p) {}
+  T    val (int r, int c);
+  void val (int r, int c, T v);
+  T   *data ();
+  T   *row (int r);
   int  rows ();
   int  cols ();
+  bool is_real ();
   void show ();   
   
 private:
   int krows;
   int kcols;
-  vector<complex<double>> *vals;
+  T  *vals;
 };
 
+typedef Matrix<double>          RMatrix;
+typedef Matrix<complex<double>> CMatrix;
+
+/***  the conjugate, for code templated on both element types  ***/
+
+static inline double          conjv (double x)          { return x; }
+static inline complex<double> conjv (complex<double> x) { return conj (x); }
+
 #if 0
 Matrix::Matrix (int r, int c)
 {
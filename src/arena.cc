@@ -0,0 +1,179 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../mtx_config.h"
+
+#include<cstdlib>
+#include<atomic>
+#include<vector>
+
+#undef PACKAGE
+#undef PACKAGE_BUGREPORT
+#undef PACKAGE_NAME
+#undef PACKAGE_STRING
+#undef PACKAGE_TARNAME
+#undef PACKAGE_URL
+#undef PACKAGE_VERSION
+#undef VERSION
+
+#include "Native_interface.hh"
+#include "APL_types.hh"
+
+#include "arena.hh"
+
+using namespace std;
+
+#define ARENA_ALIGN	64
+#define ARENA_MIN	(64 * 1024)
+
+static atomic<size_t> arena_cap (1UL << 30);
+static atomic<size_t> arena_charged (0);	// by every thread, this call
+static thread_local bool arena_worker = false;
+
+/***
+    The main chunk serves the bump allocations.  Anything that doesn't fit
+    goes into a spill chunk of its own, and when the call ends the spills
+    are freed and the main chunk is regrown to hold the whole call next
+    time.
+ ***/
+
+struct ArenaState
+{
+  char          *chunk = nullptr;
+  size_t         size  = 0;
+  size_t         used  = 0;
+  vector<char *> spills;
+  size_t         spilled = 0;
+  size_t         peak  = 0;
+  int            depth = 0;
+
+  ~ArenaState ()
+  {
+    for (char *s : spills) free (s);
+    free (chunk);
+  }
+};
+
+static thread_local ArenaState arena;
+
+static inline size_t
+roundUp (size_t bytes)
+{
+  return (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+static void
+fail (size_t bytes, bool capped)
+{
+  if (arena_worker) throw ArenaFull { bytes, capped };
+  Arena::full (ArenaFull { bytes, capped });
+}
+
+void
+Arena::full (const ArenaFull &e)
+{
+  if (e.capped)
+    MORE_ERROR () << "mtx scratch space would exceed the "
+		  << arena_cap << " byte limit (see mtx['arena'])";
+  else
+    MORE_ERROR () << "Unable to allocate " << e.bytes << " bytes";
+  WS_FULL;
+}
+
+void
+Arena::set_worker ()
+{
+  arena_worker = true;
+}
+
+void *
+Arena::alloc (size_t bytes)
+{
+  bytes = roundUp (bytes ? bytes : 1);
+
+  if (arena_charged.fetch_add (bytes) + bytes > arena_cap) {
+    arena_charged -= bytes;
+    fail (bytes, true);
+  }
+
+  if (arena.used + bytes <= arena.size) {
+    void *p = arena.chunk + arena.used;
+    arena.used += bytes;
+    if (arena.used + arena.spilled > arena.peak)
+      arena.peak = arena.used + arena.spilled;
+    return p;
+  }
+
+  char *s = (char *)aligned_alloc (ARENA_ALIGN, bytes);
+  if (!s) {
+    arena_charged -= bytes;
+    fail (bytes, false);
+  }
+  arena.spills.push_back (s);
+  arena.spilled += bytes;
+  if (arena.used + arena.spilled > arena.peak)
+    arena.peak = arena.used + arena.spilled;
+  return s;
+}
+
+size_t
+Arena::enter ()
+{
+  arena.depth++;
+  return arena.used;
+}
+
+void
+Arena::leave (size_t mark)
+{
+  if (--arena.depth > 0) {
+    arena_charged -= arena.used - mark;
+    arena.used = mark;		// spills stay until the outermost exit
+    return;
+  }
+
+  arena_charged -= arena.used + arena.spilled;
+
+  if (!arena.spills.empty ()) {
+    size_t want = roundUp (arena.peak);
+    if (want < ARENA_MIN) want = ARENA_MIN;
+    for (char *s : arena.spills) free (s);
+    arena.spills.clear ();
+    free (arena.chunk);
+    arena.chunk = (char *)aligned_alloc (ARENA_ALIGN, want);
+    arena.size  = arena.chunk ? want : 0;
+  }
+  arena.used    = 0;
+  arena.spilled = 0;
+  arena.peak    = 0;
+}
+
+size_t
+Arena::get_cap ()
+{
+  return arena_cap;
+}
+
+void
+Arena::set_cap (size_t bytes)
+{
+  arena_cap = bytes;
+}
@@ -0,0 +1,78 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include<cstddef>
+
+/***
+    Per-thread bump allocator for the scratch space used within a single
+    mtx call.  Everything allocated is 64-byte aligned and is released all
+    at once when the outermost ArenaScope on the thread exits, so there is
+    no free ().  A nested ArenaScope hands back the main-chunk space taken
+    inside it when it exits, so loops over many slices can run each slice
+    in a scope of its own.  The arena keeps its memory between calls, growing to the
+    high-water mark of the calls it has seen, so once it's warmed up small
+    calls make no malloc () calls at all.
+
+    The total allocated within one call, summed over the calling thread
+    and any pool workers helping it, is capped (by default at 1GiB,
+    settable with mtx['arena']) and exceeding it raises WS FULL.
+ ***/
+
+/***
+    What alloc () throws on a pool worker instead of raising WS FULL, as
+    only the interpreter's own thread may touch its error state.
+    parallelFor () catches it and calls Arena::full () once back there.
+ ***/
+
+struct ArenaFull
+{
+  size_t bytes;
+  bool   capped;	// over the cap, rather than out of memory
+};
+
+class Arena
+{
+public:
+  static void  *alloc (size_t bytes);
+  static size_t enter ();
+  static void   leave (size_t mark);
+  static size_t get_cap ();
+  static void   set_cap (size_t bytes);
+  static void   set_worker ();
+  static void   full (const ArenaFull &e);
+};
+
+class ArenaScope
+{
+public:
+  ArenaScope ()  { mark = Arena::enter (); }
+  ~ArenaScope () { Arena::leave (mark); }
+private:
+  size_t mark;
+};
+
+template<typename T> T *
+arenaArray (size_t count)
+{
+  return (T *)Arena::alloc (count * sizeof(T));
+}
@@ -0,0 +1,220 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../mtx_config.h"
+
+#include<cmath>
+#include<complex>
+
+#undef PACKAGE
+#undef PACKAGE_BUGREPORT
+#undef PACKAGE_NAME
+#undef PACKAGE_STRING
+#undef PACKAGE_TARNAME
+#undef PACKAGE_URL
+#undef PACKAGE_VERSION
+#undef VERSION
+
+#include "arena.hh"
+#include "linalg.hh"
+#include "pool.hh"
+#include "covacc.hh"
+
+static vector<CovAccumulator *> accs;	// handle h is accs[h - 1]
+
+CovAccumulator::CovAccumulator (int dim)
+  : d (dim), n (0.0), mean (dim, 0.0), M2 (dim * dim, 0.0)
+{
+}
+
+/***
+    Folds in nb samples with means mb and co-moments Mb:
+        δ  = mb - ma
+        M2 = Ma + Mb + δ δᴴ na nb / n
+        m  = ma + δ nb / n
+ ***/
+
+template<typename T> void
+CovAccumulator::combine (double nb, const T *mb, const T *Mb)
+{
+  if (nb == 0.0) return;
+  const double na = n;
+  const double nn = na + nb;
+  const double f  = na * nb / nn;
+  complex<double> *delta = arenaArray<complex<double>> (d);
+  for (int i = 0; i < d; i++) delta[i] = mb[i] - mean[i];
+  for (int i = 0; i < d; i++) {
+    complex<double> *row = M2.data () + i * d;
+    for (int j = 0; j < d; j++)
+      row[j] += Mb[i * d + j] + f * delta[i] * conj (delta[j]);
+  }
+  for (int i = 0; i < d; i++) mean[i] += delta[i] * (nb / nn);
+  n = nn;
+}
+
+void
+CovAccumulator::add (double *x, int cols)
+{
+  if (cols == 0) return;
+  double *mb = arenaArray<double> (d);
+  double *Mb = arenaArray<double> (d * d);
+  getCoMoments (x, d, cols, 1.0, mb, Mb);
+  combine (cols, mb, Mb);
+}
+
+void
+CovAccumulator::add (complex<double> *x, int cols)
+{
+  if (cols == 0) return;
+  complex<double> *mb = arenaArray<complex<double>> (d);
+  complex<double> *Mb = arenaArray<complex<double>> (d * d);
+  getCoMoments (x, d, cols, 1.0, mb, Mb);
+  combine (cols, mb, Mb);
+}
+
+void
+CovAccumulator::merge (CovAccumulator &other)
+{
+  combine (other.n, other.mean.data (), other.M2.data ());
+}
+
+/***
+    The sample covariance, as mtx['C'] would give for all the samples
+    seen; count () must be at least 2.
+ ***/
+
+void
+CovAccumulator::covariance (CMatrix *cov)
+{
+  for (int i = 0; i < d * d; i++) cov->data ()[i] = M2[i] / (n - 1.0);
+}
+
+/***
+    The correlation matrix.  Returns false if a variable has no variance.
+ ***/
+
+bool
+CovAccumulator::correlation (CMatrix *corr)
+{
+  double *sdev = arenaArray<double> (d);
+  for (int i = 0; i < d; i++) {
+    sdev[i] = sqrt (M2[i * d + i].real ());
+    if (sdev[i] == 0.0) return false;
+  }
+  for (int i = 0; i < d; i++)
+    for (int j = 0; j < d; j++)
+      corr->row (i)[j] = M2[i * d + j] / (sdev[i] * sdev[j]);
+  return true;
+}
+
+/***
+    Moves sample y, taken from column yc of x, out of the running means
+    and co-moments of n samples, and then sample x[, xc] in.
+ ***/
+
+template<typename T> static void
+slide (const T *x, int dim, int len, int yc, int xc, int n,
+       T *mean, T *M2, T *delta)
+{
+  const double nn = n;
+  for (int i = 0; i < dim; i++) delta[i] = x[i * len + yc] - mean[i];
+  for (int i = 0; i < dim; i++) mean[i] -= delta[i] / (nn - 1.0);
+  for (int i = 0; i < dim; i++)
+    for (int j = 0; j < dim; j++)
+      M2[i * dim + j] -= (nn / (nn - 1.0)) * delta[i] * conjv (delta[j]);
+
+  for (int i = 0; i < dim; i++) delta[i] = x[i * len + xc] - mean[i];
+  for (int i = 0; i < dim; i++) mean[i] += delta[i] / nn;
+  for (int i = 0; i < dim; i++)
+    for (int j = 0; j < dim; j++)
+      M2[i * dim + j] += ((nn - 1.0) / nn) * delta[i] * conjv (delta[j]);
+}
+
+template<typename T> void
+rollingCovariance (const T *x, int dim, int len, int w, bool last, T *out)
+{
+  const int    windows = len - w + 1;
+  const int    first   = last ? windows - 1 : 0;
+  const size_t runs    = (windows - first + w - 1) / w;
+  const int    dd      = dim * dim;
+
+  parallelFor (runs, [&] (size_t run) {
+    T *win   = arenaArray<T> (dim * w);
+    T *mean  = arenaArray<T> (dim);
+    T *M2    = arenaArray<T> (dd);
+    T *delta = arenaArray<T> (dim);
+    const int start = first + run * w;
+    const int end   = min (start + w, windows);
+
+    for (int i = 0; i < dim; i++)
+      for (int c = 0; c < w; c++) win[i * w + c] = x[i * len + start + c];
+    getCoMoments (win, dim, w, 1.0, mean, M2);
+
+    for (int s = start; s < end; s++) {
+      if (s > start) slide (x, dim, len, s - 1, s + w - 1, w, mean, M2, delta);
+      T *dst = out + (s - first) * dd;
+      for (int i = 0; i < dd; i++) dst[i] = M2[i] / (w - 1.0);
+    }
+  });
+}
+
+template void rollingCovariance (const double *x, int dim, int len, int w,
+				 bool last, double *out);
+template void rollingCovariance (const complex<double> *x, int dim, int len,
+				 int w, bool last, complex<double> *out);
+
+int
+accOpen (int dim)
+{
+  CovAccumulator *acc = new CovAccumulator (dim);
+  for (size_t h = 0; h < accs.size (); h++) {
+    if (!accs[h]) {
+      accs[h] = acc;
+      return h + 1;
+    }
+  }
+  accs.push_back (acc);
+  return accs.size ();
+}
+
+CovAccumulator *
+accGet (long handle)
+{
+  if (handle < 1 || handle > (long)accs.size ()) return nullptr;
+  return accs[handle - 1];
+}
+
+bool
+accFree (long handle)
+{
+  CovAccumulator *acc = accGet (handle);
+  if (!acc) return false;
+  delete acc;
+  accs[handle - 1] = nullptr;
+  return true;
+}
+
+void
+accCloseAll ()
+{
+  for (auto acc : accs) delete acc;
+  accs.clear ();
+}
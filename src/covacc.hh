@@ -0,0 +1,86 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include<complex>
+#include<vector>
+
+#include "Matrix.hh"
+
+using namespace std;
+
+/***
+    A streaming covariance accumulator over dim variables, for sample sets
+    too large to hold at once.  Each chunk given to add () is a dim × n
+    matrix, laid out like the argument of mtx['C'], whose columns are n
+    more samples; it's centred and reduced to its means and co-moments by
+    one BLAS rank-k update, and those are folded in by the pairwise update
+    of Chan, Golub and LeVeque, which is numerically stable however the
+    samples are chunked.  Two accumulators over the same variables merge
+    the same way, so partial results computed separately can be combined.
+
+    The running state is kept in complex arithmetic, so real and complex
+    chunks can be mixed; a real chunk is reduced in real arithmetic.
+    Accumulators outlive the mtx call that opened them and are referred to
+    from APL by handle.
+ ***/
+
+class CovAccumulator
+{
+public:
+  CovAccumulator (int dim);
+  int    dim ()   { return d; }
+  double count () { return n; }
+  void   add (double *x, int cols);		// x is overwritten
+  void   add (complex<double> *x, int cols);	// x is overwritten
+  void   merge (CovAccumulator &other);
+  void   covariance (CMatrix *cov);
+  bool   correlation (CMatrix *corr);
+
+private:
+  template<typename T> void combine (double nb, const T *mb, const T *Mb);
+  int    d;
+  double n;
+  vector<complex<double>> mean;
+  vector<complex<double>> M2;
+};
+
+/***
+    Sample covariances over a window of w samples sliding along the
+    dim × len series x, one window ending at each sample from the w-th
+    on, into out as len - w + 1 dim × dim matrices, or if last only the
+    final one.  Each step removes the oldest sample from the window's
+    means and co-moments and adds the newest, an O(dim²) update whatever
+    w is.  To keep rounding from building up, each run of w steps starts
+    from a window recomputed in full, which costs no more per step
+    overall, and the runs are independent, so they're shared out over the
+    thread pool.  Needs 2 ≤ w ≤ len.
+ ***/
+
+template<typename T>
+void rollingCovariance (const T *x, int dim, int len, int w, bool last,
+			T *out);
+
+int             accOpen (int dim);
+CovAccumulator *accGet (long handle);
+bool            accFree (long handle);
+void            accCloseAll ();
@@ -23,11 +23,14 @@
 
 #include<cmath>
 #include<complex>
+#include<cstring>
 #include<iostream>
 #include<fstream>
 #include<string>
-
-#include <alloca.h>
+#include<cstdint>
+#include<algorithm>
+#include<map>
+#include<mutex>
 
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_eigen.h>
@@ -43,90 +46,669 @@
 
 #include "Shape.hh"
 #include "Matrix.hh"
+#include "arena.hh"
+#include "simd.hh"
 
 /***
     a←4 4 ⍴ ¯1 1 ¯1 1 ¯8 4 ¯2 1 27 9 3 1 64 16 4 1
  ***/
 
-Matrix
-getEigenvectors (Matrix *mtx)
+/***
+    The GSL vectors, matrices, and workspaces for one problem size.  They
+    are allocated as they're first needed and then kept in a pool, by size,
+    so that repeated calls of the same size don't go back to the allocator.
+    Everything in the pool is freed by eigensClose ().  The Krylov
+    solvers' projected problems change size at every check, so their
+    buffers come from newBuffers () and go straight back with
+    freeBuffers (), and never take up pool slots.
+ ***/
+
+struct EigenBuffers
 {
-  Matrix res (mtx->rows (), mtx->cols ());
+  size_t dim;
+  gsl_matrix                   *data;
+  gsl_matrix_complex           *cdata;
+  gsl_vector                   *reval;
+  gsl_vector_complex           *eval;
+  gsl_matrix                   *rvec;
+  gsl_matrix_complex           *evec;
+  gsl_eigen_nonsymmv_workspace *nonsymmv;
+  gsl_eigen_symmv_workspace    *symmv;
+  gsl_eigen_hermv_workspace    *hermv;
+  gsl_eigen_nonsymm_workspace  *nonsymm;
+  gsl_eigen_symm_workspace     *symm;
+  gsl_eigen_herm_workspace     *herm;
+  gsl_matrix_view               dview;	// in-place input
+  gsl_matrix_complex_view       cdview;
+};
+
+#define MAX_POOLED_SIZES	8
+#define MAX_POOLED_PER_SIZE	4
+
+static map<size_t, vector<EigenBuffers *>> pool;
+static mutex pool_lock;
 
-  double *data =
-    (double *)alloca (mtx->rows () * mtx->cols () * sizeof(double));
-  int i = 0;
-  for (int j = 0; j < mtx->rows (); j++) {
-    for (int k = 0; k < mtx->cols (); k++, i++) {
-      data[i] = mtx->val (j, k).real ();
+static EigenBuffers *
+newBuffers (size_t dim)
+{
+  EigenBuffers *eb = new EigenBuffers ();
+  eb->dim = dim;
+  return eb;
+}
+
+static EigenBuffers *
+acquireBuffers (size_t dim)
+{
+  {
+    lock_guard<mutex> guard (pool_lock);
+    auto it = pool.find (dim);
+    if (it != pool.end () && !it->second.empty ()) {
+      EigenBuffers *eb = it->second.back ();
+      it->second.pop_back ();
+      return eb;
     }
   }
-  
-  gsl_matrix_view m = gsl_matrix_view_array (data, mtx->rows (), mtx->cols ());
+  return newBuffers (dim);
+}
+
+static void
+freeBuffers (EigenBuffers *eb)
+{
+  if (eb->data)     gsl_matrix_free (eb->data);
+  if (eb->cdata)    gsl_matrix_complex_free (eb->cdata);
+  if (eb->reval)    gsl_vector_free (eb->reval);
+  if (eb->eval)     gsl_vector_complex_free (eb->eval);
+  if (eb->rvec)     gsl_matrix_free (eb->rvec);
+  if (eb->evec)     gsl_matrix_complex_free (eb->evec);
+  if (eb->nonsymmv) gsl_eigen_nonsymmv_free (eb->nonsymmv);
+  if (eb->symmv)    gsl_eigen_symmv_free (eb->symmv);
+  if (eb->hermv)    gsl_eigen_hermv_free (eb->hermv);
+  if (eb->nonsymm)  gsl_eigen_nonsymm_free (eb->nonsymm);
+  if (eb->symm)     gsl_eigen_symm_free (eb->symm);
+  if (eb->herm)     gsl_eigen_herm_free (eb->herm);
+  delete eb;
+}
+
+static void
+releaseBuffers (EigenBuffers *eb)
+{
+  {
+    lock_guard<mutex> guard (pool_lock);
+    auto it = pool.find (eb->dim);
+    if (it == pool.end () && pool.size () < MAX_POOLED_SIZES)
+      it = pool.emplace (eb->dim, vector<EigenBuffers *> ()).first;
+    if (it != pool.end () && it->second.size () < MAX_POOLED_PER_SIZE) {
+      it->second.push_back (eb);
+      return;
+    }
+  }
+  freeBuffers (eb);
+}
+
+void
+eigensClose ()
+{
+  lock_guard<mutex> guard (pool_lock);
+  for (auto & it : pool) {
+    for (EigenBuffers *eb : it.second) freeBuffers (eb);
+  }
+  pool.clear ();
+}
 
-  gsl_vector_complex *eval = gsl_vector_complex_alloc (mtx->rows ());
-  gsl_matrix_complex *evec =
-    gsl_matrix_complex_alloc (mtx->rows (), mtx->cols ());
+/***
+    The input matrix as the solvers want it.  The storage of a Matrix is
+    already laid out as GSL's, so where the types agree the solvers work
+    on it in place, overwriting it; otherwise it's copied into the pooled
+    buffers.
+ ***/
 
-  gsl_eigen_nonsymmv_workspace *w = gsl_eigen_nonsymmv_alloc (mtx->rows ());
+static gsl_matrix *
+realData (EigenBuffers *eb, RMatrix *mtx)
+{
+  eb->dview = gsl_matrix_view_array (mtx->data (), eb->dim, eb->dim);
+  return &eb->dview.matrix;
+}
 
-  gsl_eigen_nonsymmv (&m.matrix, eval, evec, w);
+static gsl_matrix *
+realData (EigenBuffers *eb, CMatrix *mtx)
+{
+  if (!eb->data) eb->data = gsl_matrix_alloc (eb->dim, eb->dim);
+  for (size_t j = 0; j < eb->dim; j++) {
+    for (size_t k = 0; k < eb->dim; k++) 
+      gsl_matrix_set (eb->data, j, k, mtx->val (j, k).real ());
+  }
+  return eb->data;
+}
 
-  gsl_eigen_nonsymmv_free (w);
+template<typename T> static gsl_matrix_complex *
+complexData (EigenBuffers *eb, Matrix<T> *mtx)
+{
+  if (!eb->cdata) eb->cdata = gsl_matrix_complex_alloc (eb->dim, eb->dim);
+  for (size_t j = 0; j < eb->dim; j++) {
+    for (size_t k = 0; k < eb->dim; k++) {
+      T v = mtx->val (j, k);
+      gsl_complex z;
+      GSL_SET_COMPLEX (&z, real (v), imag (v));
+      gsl_matrix_complex_set (eb->cdata, j, k, z);
+    }
+  }
+  return eb->cdata;
+}
+
+static gsl_matrix_complex *
+complexData (EigenBuffers *eb, CMatrix *mtx)
+{
+  eb->cdview = gsl_matrix_complex_view_array ((double *)mtx->data (),
+					      eb->dim, eb->dim);
+  return &eb->cdview.matrix;
+}
 
-  gsl_eigen_nonsymmv_sort (eval, evec, GSL_EIGEN_SORT_ABS_DESC);
+/***
+    True if mtx equals its conjugate transpose, which for a real matrix
+    just means symmetric.  Covariance matrices always are, and for those
+    the symmetric solvers are much faster and give real eigenvalues and
+    orthonormal eigenvectors.
+ ***/
 
-  int k = 0;
+template<typename T> bool
+isHermitian (Matrix<T> *mtx)
+{
+  for (int r = 0; r < mtx->rows (); r++) {
+    for (int c = r; c < mtx->cols (); c++) {
+      if (mtx->val (r, c) != conjv (mtx->val (c, r))) return false;
+    }
+  }
+  return true;
+}
+
+/***
+    Eigensystem of a symmetric or Hermitian matrix, sorted by descending
+    magnitude, into eb->reval and the columns of eb->rvec (real) or
+    eb->evec (complex).  Returns true if the vectors are real.
+ ***/
+
+template<typename T> static bool
+getHermitianEigens (EigenBuffers *eb, Matrix<T> *mtx)
+{
+  size_t dim = eb->dim;
+  if (!eb->reval) eb->reval = gsl_vector_alloc (dim);
   
-  for (int i = 0; i < mtx->cols (); i++) {
-    gsl_vector_complex_view evec_i = gsl_matrix_complex_column (evec, i);
-    
-    for (int j = 0; j < mtx->rows (); j++) {
-      gsl_complex z = gsl_vector_complex_get(&evec_i.vector, j);
-      complex<double> v (GSL_REAL(z), GSL_IMAG(z));
-      res.val (i, j, v);
+  if (mtx->is_real ()) {
+    gsl_matrix *data = realData (eb, mtx);
+    if (!eb->rvec)  eb->rvec  = gsl_matrix_alloc (dim, dim);
+    if (!eb->symmv) eb->symmv = gsl_eigen_symmv_alloc (dim);
+    gsl_eigen_symmv (data, eb->reval, eb->rvec, eb->symmv);
+    gsl_eigen_symmv_sort (eb->reval, eb->rvec, GSL_EIGEN_SORT_ABS_DESC);
+    return true;
+  }
+  
+  gsl_matrix_complex *cdata = complexData (eb, mtx);
+  if (!eb->evec)  eb->evec  = gsl_matrix_complex_alloc (dim, dim);
+  if (!eb->hermv) eb->hermv = gsl_eigen_hermv_alloc (dim);
+  gsl_eigen_hermv (cdata, eb->reval, eb->evec, eb->hermv);
+  gsl_eigen_hermv_sort (eb->reval, eb->evec, GSL_EIGEN_SORT_ABS_DESC);
+  return false;
+}
+
+/***
+    Eigensystem of a general matrix, sorted by descending magnitude, into
+    eb->eval and the columns of eb->evec.  GSL has no general complex
+    solver, so mtx must be real; callers check with isHermitian () first.
+ ***/
+
+template<typename T> static void
+getNonsymmetricEigens (EigenBuffers *eb, Matrix<T> *mtx)
+{
+  size_t dim = eb->dim;
+  gsl_matrix *data = realData (eb, mtx);
+  if (!eb->eval)     eb->eval     = gsl_vector_complex_alloc (dim);
+  if (!eb->evec)     eb->evec     = gsl_matrix_complex_alloc (dim, dim);
+  if (!eb->nonsymmv) eb->nonsymmv = gsl_eigen_nonsymmv_alloc (dim);
+  gsl_eigen_nonsymmv (data, eb->eval, eb->evec, eb->nonsymmv);
+  gsl_eigen_nonsymmv_sort (eb->eval, eb->evec, GSL_EIGEN_SORT_ABS_DESC);
+}
+
+/***
+    Eigenvalues and eigenvectors from a single decomposition, sorted by
+    descending magnitude.  vals must be of length n and vecs n × n;
+    vecs[i;] is the eigenvector corresponding to vals[i].
+ ***/
+
+template<typename T> void
+getEigensystem (Matrix<T> *mtx, vector<complex<double>> &vals, CMatrix *vecs)
+{
+  int dim = mtx->rows ();
+  EigenBuffers *eb = acquireBuffers (dim);
+
+  if (isHermitian (mtx)) {
+    bool real_vecs = getHermitianEigens (eb, mtx);
+    for (int i = 0; i < dim; i++) {
+      vals[i] = complex<double> (gsl_vector_get (eb->reval, i), 0.0);
+      for (int j = 0; j < dim; j++) {
+	if (real_vecs)
+	  vecs->val (i, j,
+		     complex<double> (gsl_matrix_get (eb->rvec, j, i), 0.0));
+	else {
+	  gsl_complex z = gsl_matrix_complex_get (eb->evec, j, i);
+	  vecs->val (i, j, complex<double> (GSL_REAL(z), GSL_IMAG(z)));
+	}
+      }
+    }
+  }
+  else {
+    getNonsymmetricEigens (eb, mtx);
+    for (int i = 0; i < dim; i++) {
+      gsl_complex eval_i = gsl_vector_complex_get (eb->eval, i);
+      vals[i] = complex<double> (GSL_REAL(eval_i), GSL_IMAG(eval_i));
+      for (int j = 0; j < dim; j++) {
+	gsl_complex z = gsl_matrix_complex_get (eb->evec, j, i);
+	vecs->val (i, j, complex<double> (GSL_REAL(z), GSL_IMAG(z)));
+      }
+    }
+  }
+  
+  releaseBuffers (eb);
+}
+
+/***
+    Eigenvalues only, sorted by descending magnitude.  Without the
+    eigenvectors the solvers needn't accumulate the Schur or tridiagonal
+    transformations, which is about half the work, and nothing n × n but
+    the input copy is needed.  General matrices are balanced first.
+ ***/
+
+template<typename T> vector<complex<double>>
+getEigenvalues (Matrix<T> *mtx)
+{
+  int dim = mtx->rows ();
+  vector<complex<double>> res (dim);
+  EigenBuffers *eb = acquireBuffers (dim);
+
+  if (isHermitian (mtx)) {
+    if (!eb->reval) eb->reval = gsl_vector_alloc (dim);
+    if (mtx->is_real ()) {
+      if (!eb->symm) eb->symm = gsl_eigen_symm_alloc (dim);
+      gsl_eigen_symm (realData (eb, mtx), eb->reval, eb->symm);
+    }
+    else {
+      if (!eb->herm) eb->herm = gsl_eigen_herm_alloc (dim);
+      gsl_eigen_herm (complexData (eb, mtx), eb->reval, eb->herm);
+    }
+    for (int i = 0; i < dim; i++) 
+      res[i] = complex<double> (gsl_vector_get (eb->reval, i), 0.0);
+  }
+  else {
+    if (!eb->eval) eb->eval = gsl_vector_complex_alloc (dim);
+    if (!eb->nonsymm) {
+      eb->nonsymm = gsl_eigen_nonsymm_alloc (dim);
+      gsl_eigen_nonsymm_params (0, 1, eb->nonsymm);
+    }
+    gsl_eigen_nonsymm (realData (eb, mtx), eb->eval, eb->nonsymm);
+    for (int i = 0; i < dim; i++) {
+      gsl_complex eval_i = gsl_vector_complex_get (eb->eval, i);
+      res[i] = complex<double> (GSL_REAL(eval_i), GSL_IMAG(eval_i));
     }
   }
 
+  releaseBuffers (eb);
+  
+  stable_sort (res.begin (), res.end (),
+	       [](const complex<double> &a, const complex<double> &b) {
+		 return abs (a) > abs (b);
+	       });
   return res;
 }
 
-vector<complex<double>>
-getEigenvalues (Matrix *mtx)
+/***
+    Top-k eigenpairs by Krylov subspace iteration: Lanczos for symmetric
+    and Hermitian matrices, Arnoldi otherwise, both with full
+    reorthogonalisation.  The subspace is extended a step at a time and
+    every so often the small projected problem is solved with GSL; once
+    the residuals of the k largest-magnitude Ritz pairs are small enough
+    they're returned.  Each step costs one n × n matrix-vector product, so
+    for k ≪ n this is far cheaper than the full O(n³) decomposition.
+ ***/
+
+#define KRYLOV_TOL	1.0e-10
+
+template<typename T> static void
+matVec (const T *a, int n, const T *x, T *y)
 {
-  vector<complex<double>> res (mtx->cols ());
+  for (int r = 0; r < n; r++) {
+    const T *ar = a + (size_t)r * n;
+    T sum = 0.0;
+    for (int c = 0; c < n; c++) sum += ar[c] * x[c];
+    y[r] = sum;
+  }
+}
+
+template<typename T> static T
+dotc (const T *x, const T *y, int n)
+{
+  T sum = 0.0;
+  for (int i = 0; i < n; i++) sum += conjv (x[i]) * y[i];
+  return sum;
+}
+
+template<typename T> static void
+axpy (T p, const T *x, T *y, int n)
+{
+  for (int i = 0; i < n; i++) y[i] += p * x[i];
+}
+
+/***  the real cases go to the SIMD kernels  ***/
+
+static inline void
+matVec (const double *a, int n, const double *x, double *y)
+{
+  denseMatVec (a, n, n, x, y);
+}
+
+static inline double
+dotc (const double *x, const double *y, int n)
+{
+  return vecDot (x, y, n);
+}
+
+static inline void
+axpy (double p, const double *x, double *y, int n)
+{
+  vecAxpy (p, x, y, n);
+}
 
-  double *data =
-    (double *)alloca (mtx->rows () * mtx->cols () * sizeof(double));
-  int i = 0;
-  for (int j = 0; j < mtx->rows (); j++) {
-    for (int k = 0; k < mtx->cols (); k++, i++) {
-      data[i] = mtx->val (j, k).real ();
+template<typename T> static void
+scal (T *x, double a, int n)
+{
+  vecScale ((double *)x, a, n * (sizeof(T) / sizeof(double)));
+}
+
+/***
+    Orthogonalises w against the first j columns of V, twice, which is
+    enough to keep them orthogonal to working precision.  If h isn't null
+    the projections are accumulated into it.  Returns ||w||.
+ ***/
+
+template<typename T> static double
+orthogonalise (const T *V, int n, int j, T *w, T *h)
+{
+  if (h) for (int i = 0; i < j; i++) h[i] = 0.0;
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < j; i++) {
+      const T *vi = V + (size_t)i * n;
+      T p = dotc (vi, w, n);
+      axpy (-p, vi, w, n);
+      if (h) h[i] += p;
     }
   }
+  return sqrt (real (dotc (w, w, n)));
+}
+
+/***
+    Deterministic pseudo-random start (and restart) vectors, so that the
+    results are reproducible.
+ ***/
+
+template<typename T> static void
+krylovStart (T *v, int n, uint64_t &state)
+{
+  for (int i = 0; i < n; i++) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    v[i] = (double)(state >> 11) / (double)(1ULL << 53) - 0.5;
+  }
+}
+
+/***
+    Extends the basis V (n × cap, one vector per row) to hold more, copying
+    what's there.  The old space stays in the Arena until the call ends.
+ ***/
+
+template<typename T> static T *
+growBasis (T *V, int n, int used, int cap)
+{
+  T *nv = arenaArray<T> ((size_t)n * cap);
+  for (size_t i = 0; i < (size_t)n * used; i++) nv[i] = V[i];
+  return nv;
+}
+
+template<typename T> static void
+lanczos (const T *a, int n, int k, vector<complex<double>> &vals,
+	 CMatrix *vecs)
+{
+  int cap = min (n, max (4 * k, k + 64));
+  T *V = arenaArray<T> ((size_t)n * cap);
+  T *w = arenaArray<T> (n);
+  double *alpha = arenaArray<double> (n);
+  double *beta  = arenaArray<double> (n);
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+  krylovStart (V, n, state);
+  double nrm = orthogonalise (V, n, 0, V, (T *)nullptr);
+  scal (V, 1.0 / nrm, n);
+
+  int j = 0;
+  int check = min (n, 2 * k + 10);
+  EigenBuffers *eb = nullptr;
   
-  gsl_matrix_view m = gsl_matrix_view_array (data, mtx->rows (), mtx->cols ());
+  for (;;) {
+    T *vj = V + (size_t)j * n;
+    matVec (a, n, vj, w);
+    alpha[j] = real (dotc (vj, w, n));
+    beta[j] = orthogonalise (V, n, j + 1, w, (T *)nullptr);
+    j++;
+    
+    double scale = 0.0;
+    for (int i = 0; i < j; i++)
+      scale = max (scale, fabs (alpha[i]) + fabs (beta[i]));
+    bool breakdown = beta[j - 1] <= 1.0e-14 * scale;
+    if (breakdown) beta[j - 1] = 0.0;
+    
+    if (j == n || (j >= check && j >= k)) {
+      if (eb) freeBuffers (eb);
+      eb = newBuffers (j);
+      if (!eb->data)  eb->data  = gsl_matrix_alloc (j, j);
+      if (!eb->reval) eb->reval = gsl_vector_alloc (j);
+      if (!eb->rvec)  eb->rvec  = gsl_matrix_alloc (j, j);
+      if (!eb->symmv) eb->symmv = gsl_eigen_symmv_alloc (j);
+      gsl_matrix_set_zero (eb->data);
+      for (int i = 0; i < j; i++) {
+	gsl_matrix_set (eb->data, i, i, alpha[i]);
+	if (i + 1 < j) {
+	  gsl_matrix_set (eb->data, i, i + 1, beta[i]);
+	  gsl_matrix_set (eb->data, i + 1, i, beta[i]);
+	}
+      }
+      gsl_eigen_symmv (eb->data, eb->reval, eb->rvec, eb->symmv);
+      gsl_eigen_symmv_sort (eb->reval, eb->rvec, GSL_EIGEN_SORT_ABS_DESC);
 
-  gsl_vector_complex *eval = gsl_vector_complex_alloc (mtx->rows ());
-  gsl_matrix_complex *evec =
-    gsl_matrix_complex_alloc (mtx->rows (), mtx->cols ());
+      double top = fabs (gsl_vector_get (eb->reval, 0));
+      bool converged = true;
+      for (int i = 0; i < k && converged; i++) {
+	double resid = beta[j - 1] * fabs (gsl_matrix_get (eb->rvec, j - 1, i));
+	if (resid > KRYLOV_TOL * max (top, 1.0e-300)) converged = false;
+      }
+      if ((converged && (!breakdown || j >= 2 * k)) || j == n) break;
+      check = j + max (8, k / 2);
+    }
 
-  gsl_eigen_nonsymmv_workspace *w = gsl_eigen_nonsymmv_alloc (mtx->rows ());
+    if (j == cap) {
+      int ncap = min (n, 2 * cap);
+      V = growBasis (V, n, j, ncap);
+      cap = ncap;
+    }
+    T *vn = V + (size_t)j * n;
+    if (breakdown) {
+      /***  invariant subspace, carry on from a fresh orthogonal start ***/
+      do {
+	krylovStart (vn, n, state);
+	nrm = orthogonalise (V, n, j, vn, (T *)nullptr);
+      } while (nrm == 0.0);
+      scal (vn, 1.0 / nrm, n);
+    }
+    else {
+      for (int l = 0; l < n; l++) vn[l] = w[l] / beta[j - 1];
+    }
+  }
 
-  gsl_eigen_nonsymmv (&m.matrix, eval, evec, w);
+  for (int i = 0; i < k; i++) {
+    vals[i] = complex<double> (gsl_vector_get (eb->reval, i), 0.0);
+    for (int l = 0; l < n; l++) {
+      T x = 0.0;
+      for (int m = 0; m < j; m++)
+	x += gsl_matrix_get (eb->rvec, m, i) * V[(size_t)m * n + l];
+      vecs->val (i, l, complex<double> (x));
+    }
+  }
+  freeBuffers (eb);
+}
 
-  gsl_eigen_nonsymmv_free (w);
+static void
+arnoldi (const double *a, int n, int k, vector<complex<double>> &vals,
+	 CMatrix *vecs)
+{
+  int cap = min (n, max (4 * k, k + 64));
+  double *V = arenaArray<double> ((size_t)n * cap);
+  double *H = arenaArray<double> ((size_t)(cap + 1) * cap);  // column-major
+  double *w = arenaArray<double> (n);
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
 
-  gsl_eigen_nonsymmv_sort (eval, evec, GSL_EIGEN_SORT_ABS_DESC);
+  krylovStart (V, n, state);
+  double nrm = orthogonalise (V, n, 0, V, (double *)nullptr);
+  scal (V, 1.0 / nrm, n);
 
-  int k = 0;
+  int j = 0;
+  int check = min (n, 2 * k + 10);
+  EigenBuffers *eb = nullptr;
   
-  for (int i = 0; i < mtx->cols (); i++) {
-    gsl_complex eval_i = gsl_vector_complex_get (eval, i);
+  for (;;) {
+    double *vj = V + (size_t)j * n;
+    double *hj = H + (size_t)j * (cap + 1);
+    matVec (a, n, vj, w);
+    hj[j + 1] = orthogonalise (V, n, j + 1, w, hj);
+    j++;
 
-    complex<double> v (GSL_REAL(eval_i), GSL_IMAG(eval_i));
-    res[i] = v;
+    double scale = 0.0;
+    for (int i = 0; i < j + 1; i++) scale = max (scale, fabs (hj[i]));
+    bool breakdown = hj[j] <= 1.0e-14 * scale;
+    if (breakdown) hj[j] = 0.0;
+    
+    if (j == n || (j >= check && j >= k)) {
+      if (eb) freeBuffers (eb);
+      eb = newBuffers (j);
+      if (!eb->data)     eb->data     = gsl_matrix_alloc (j, j);
+      if (!eb->eval)     eb->eval     = gsl_vector_complex_alloc (j);
+      if (!eb->evec)     eb->evec     = gsl_matrix_complex_alloc (j, j);
+      if (!eb->nonsymmv) eb->nonsymmv = gsl_eigen_nonsymmv_alloc (j);
+      for (int c = 0; c < j; c++) {
+	for (int r = 0; r < j; r++)
+	  gsl_matrix_set (eb->data, r, c,
+			  (r <= c + 1) ? H[(size_t)c * (cap + 1) + r] : 0.0);
+      }
+      gsl_eigen_nonsymmv (eb->data, eb->eval, eb->evec, eb->nonsymmv);
+      gsl_eigen_nonsymmv_sort (eb->eval, eb->evec, GSL_EIGEN_SORT_ABS_DESC);
+
+      gsl_complex z = gsl_vector_complex_get (eb->eval, 0);
+      double top = hypot (GSL_REAL (z), GSL_IMAG (z));
+      bool converged = true;
+      for (int i = 0; i < k && converged; i++) {
+	gsl_complex y = gsl_matrix_complex_get (eb->evec, j - 1, i);
+	double resid = hj[j] * hypot (GSL_REAL (y), GSL_IMAG (y));
+	if (resid > KRYLOV_TOL * max (top, 1.0e-300)) converged = false;
+      }
+      if ((converged && (!breakdown || j >= 2 * k)) || j == n) break;
+      check = j + max (8, k / 2);
+    }
+
+    if (j == cap) {
+      int ncap = min (n, 2 * cap);
+      V = growBasis (V, n, j, ncap);
+      double *nh = arenaArray<double> ((size_t)(ncap + 1) * ncap);
+      for (int c = 0; c < j; c++) {
+	for (int r = 0; r <= c + 1; r++)
+	  nh[(size_t)c * (ncap + 1) + r] = H[(size_t)c * (cap + 1) + r];
+      }
+      H = nh;
+      cap = ncap;
+    }
+    double *vn = V + (size_t)j * n;
+    if (breakdown) {
+      do {
+	krylovStart (vn, n, state);
+	nrm = orthogonalise (V, n, j, vn, (double *)nullptr);
+      } while (nrm == 0.0);
+      scal (vn, 1.0 / nrm, n);
+    }
+    else {
+      double hn = H[(size_t)(j - 1) * (cap + 1) + j];
+      for (int l = 0; l < n; l++) vn[l] = w[l] / hn;
+    }
   }
-  return res;
+
+  for (int i = 0; i < k; i++) {
+    gsl_complex z = gsl_vector_complex_get (eb->eval, i);
+    vals[i] = complex<double> (GSL_REAL (z), GSL_IMAG (z));
+    for (int l = 0; l < n; l++) {
+      complex<double> x = 0.0;
+      for (int m = 0; m < j; m++) {
+	gsl_complex y = gsl_matrix_complex_get (eb->evec, m, i);
+	x += complex<double> (GSL_REAL (y), GSL_IMAG (y)) * V[(size_t)m * n + l];
+      }
+      vecs->val (i, l, x);
+    }
+  }
+  freeBuffers (eb);
+}
+
+/***
+    The k largest-magnitude eigenvalues, and eigenvectors in the rows of
+    the k × n vecs, of mtx.  Small problems, or ones where k is a large
+    fraction of n, are just done densely.
+ ***/
+
+template<typename T> void
+getTopEigensystem (Matrix<T> *mtx, int k, vector<complex<double>> &vals,
+		   CMatrix *vecs)
+{
+  int n = mtx->rows ();
+
+  if (n <= 128 || 4 * k >= n) {
+    vector<complex<double>> all (n);
+    CMatrix allvecs (n, n);
+    getEigensystem (mtx, all, &allvecs);
+    for (int i = 0; i < k; i++) {
+      vals[i] = all[i];
+      for (int l = 0; l < n; l++) vecs->val (i, l, allvecs.val (i, l));
+    }
+    return;
+  }
+  
+  if (isHermitian (mtx) && !mtx->is_real ()) {
+    complex<double> *a = arenaArray<complex<double>> ((size_t)n * n);
+    for (int r = 0; r < n; r++) {
+      for (int c = 0; c < n; c++) a[(size_t)r * n + c] = mtx->val (r, c);
+    }
+    lanczos (a, n, k, vals, vecs);
+    return;
+  }
+  
+  double *a = arenaArray<double> ((size_t)n * n);
+  for (int r = 0; r < n; r++) {
+    for (int c = 0; c < n; c++) a[(size_t)r * n + c] = real (mtx->val (r, c));
+  }
+  if (isHermitian (mtx))
+    lanczos (a, n, k, vals, vecs);
+  else
+    arnoldi (a, n, k, vals, vecs);
 }
 
+template bool isHermitian (RMatrix *mtx);
+template bool isHermitian (CMatrix *mtx);
+template void getEigensystem (RMatrix *mtx, vector<complex<double>> &vals,
+			      CMatrix *vecs);
+template void getEigensystem (CMatrix *mtx, vector<complex<double>> &vals,
+			      CMatrix *vecs);
+template vector<complex<double>> getEigenvalues (RMatrix *mtx);
+template vector<complex<double>> getEigenvalues (CMatrix *mtx);
+template void getTopEigensystem (RMatrix *mtx, int k,
+				 vector<complex<double>> &vals, CMatrix *vecs);
+template void getTopEigensystem (CMatrix *mtx, int k,
+				 vector<complex<double>> &vals, CMatrix *vecs);
@@ -24,5 +24,19 @@
 #include "Matrix.hh"
 #include "eigens.hh"
 
-vector<complex<double>> getEigenvalues (Matrix *mtx);
-Matrix getEigenvectors (Matrix *mtx);
+/***
+    The solvers work in place where they can, so mtx is overwritten.  A
+    complex mtx must be Hermitian, as GSL has no general complex solver.
+ ***/
+
+template<typename T>
+bool isHermitian (Matrix<T> *mtx);
+template<typename T>
+vector<complex<double>> getEigenvalues (Matrix<T> *mtx);
+void eigensClose ();
+template<typename T>
+void getEigensystem (Matrix<T> *mtx, vector<complex<double>> &vals,
+		     CMatrix *vecs);
+template<typename T>
+void getTopEigensystem (Matrix<T> *mtx, int k, vector<complex<double>> &vals,
+			CMatrix *vecs);
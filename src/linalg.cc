@@ -0,0 +1,787 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../mtx_config.h"
+
+#include<cfloat>
+#include<cmath>
+#include<complex>
+#include<cstring>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_math.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_blas.h>
+
+#undef PACKAGE
+#undef PACKAGE_BUGREPORT
+#undef PACKAGE_NAME
+#undef PACKAGE_STRING
+#undef PACKAGE_TARNAME
+#undef PACKAGE_URL
+#undef PACKAGE_VERSION
+#undef VERSION
+
+#include "Matrix.hh"
+#include "arena.hh"
+#include "rng.hh"
+#include "simd.hh"
+#include "linalg.hh"
+
+void
+LUFactor::init (int n)
+{
+  dim  = n;
+  permv.size = dim;
+  permv.data = arenaArray<size_t> (dim);
+  perm = &permv;
+  rscale = arenaArray<double> (dim);
+  cscale = arenaArray<double> (dim);
+  lu   = nullptr;
+  clu  = nullptr;
+}
+
+/***
+    Row and then column scale factors, as LAPACK's dgeequ, that bring the
+    largest element of every row and column of mtx to 1, and the 1-norm of
+    mtx so scaled.  A zero row or column is left alone; it leaves a zero
+    pivot anyway.
+ ***/
+
+template<typename T> void
+LUFactor::equilibrate (Matrix<T> *mtx)
+{
+  for (int r = 0; r < dim; r++) {
+    double big = 0.0;
+    for (int c = 0; c < dim; c++) big = fmax (big, abs (mtx->val (r, c)));
+    rscale[r] = (big > 0.0) ? 1.0 / big : 1.0;
+  }
+  for (int c = 0; c < dim; c++) {
+    double big = 0.0;
+    for (int r = 0; r < dim; r++)
+      big = fmax (big, rscale[r] * abs (mtx->val (r, c)));
+    cscale[c] = (big > 0.0) ? 1.0 / big : 1.0;
+  }
+  anorm = 0.0;
+  for (int c = 0; c < dim; c++) {
+    double sum = 0.0;
+    for (int r = 0; r < dim; r++)
+      sum += rscale[r] * abs (mtx->val (r, c)) * cscale[c];
+    anorm = fmax (anorm, sum);
+  }
+}
+
+LUFactor::LUFactor (RMatrix *mtx)
+{
+  init (mtx->rows ());
+  equilibrate (mtx);
+  luv = gsl_matrix_view_array (mtx->data (), dim, dim);
+  lu  = &luv.matrix;
+  gsl_linalg_LU_decomp (lu, perm, &signum);
+}
+
+LUFactor::LUFactor (CMatrix *mtx)
+{
+  init (mtx->rows ());
+  equilibrate (mtx);
+
+  if (mtx->is_real ()) {
+    luv = gsl_matrix_view_array (arenaArray<double> (dim * dim), dim, dim);
+    lu  = &luv.matrix;
+    for (int r = 0; r < dim; r++) {
+      for (int c = 0; c < dim; c++)
+	gsl_matrix_set (lu, r, c, mtx->val (r, c).real ());
+    }
+    gsl_linalg_LU_decomp (lu, perm, &signum);
+  }
+  else {
+    cluv = gsl_matrix_complex_view_array ((double *)mtx->data (), dim, dim);
+    clu  = &cluv.matrix;
+    gsl_linalg_complex_LU_decomp (clu, perm, &signum);
+  }
+}
+
+LUFactor::~LUFactor ()
+{
+}
+
+bool
+LUFactor::is_singular ()
+{
+  for (int i = 0; i < dim; i++) {
+    if (lu) {
+      if (gsl_matrix_get (lu, i, i) == 0.0) return true;
+    }
+    else {
+      gsl_complex z = gsl_matrix_complex_get (clu, i, i);
+      if (GSL_REAL (z) == 0.0 && GSL_IMAG (z) == 0.0) return true;
+    }
+  }
+  return false;
+}
+
+/***
+    v ← A⁻¹ v, or A⁻ᴴ v if trans is set, for a single vector, by the
+    same triangular solves as solve ():  P A = L U, so A⁻¹ = U⁻¹ L⁻¹ P and
+    A⁻ᴴ = Pᵀ L⁻ᴴ U⁻ᴴ.
+ ***/
+
+void
+LUFactor::solveVec (double *v, bool trans)
+{
+  double *w = arenaArray<double> (dim);
+  gsl_matrix_view wv = gsl_matrix_view_array (w, dim, 1);
+  if (!trans) {
+    for (int r = 0; r < dim; r++) w[r] = v[gsl_permutation_get (perm, r)];
+    gsl_blas_dtrsm (CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
+		    1.0, lu, &wv.matrix);
+    gsl_blas_dtrsm (CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit,
+		    1.0, lu, &wv.matrix);
+    memcpy (v, w, dim * sizeof(double));
+  }
+  else {
+    memcpy (w, v, dim * sizeof(double));
+    gsl_blas_dtrsm (CblasLeft, CblasUpper, CblasTrans, CblasNonUnit,
+		    1.0, lu, &wv.matrix);
+    gsl_blas_dtrsm (CblasLeft, CblasLower, CblasTrans, CblasUnit,
+		    1.0, lu, &wv.matrix);
+    for (int r = 0; r < dim; r++) v[gsl_permutation_get (perm, r)] = w[r];
+  }
+}
+
+void
+LUFactor::solveVec (complex<double> *v, bool trans)
+{
+  complex<double> *w = arenaArray<complex<double>> (dim);
+  gsl_matrix_complex_view wv =
+    gsl_matrix_complex_view_array ((double *)w, dim, 1);
+  gsl_complex one;
+  GSL_SET_COMPLEX (&one, 1.0, 0.0);
+  if (!trans) {
+    for (int r = 0; r < dim; r++) w[r] = v[gsl_permutation_get (perm, r)];
+    gsl_blas_ztrsm (CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
+		    one, clu, &wv.matrix);
+    gsl_blas_ztrsm (CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit,
+		    one, clu, &wv.matrix);
+    memcpy (v, w, dim * sizeof(complex<double>));
+  }
+  else {
+    memcpy (w, v, dim * sizeof(complex<double>));
+    gsl_blas_ztrsm (CblasLeft, CblasUpper, CblasConjTrans, CblasNonUnit,
+		    one, clu, &wv.matrix);
+    gsl_blas_ztrsm (CblasLeft, CblasLower, CblasConjTrans, CblasUnit,
+		    one, clu, &wv.matrix);
+    for (int r = 0; r < dim; r++) v[gsl_permutation_get (perm, r)] = w[r];
+  }
+}
+
+/***
+    Hager's estimate of ‖B‖₁ for B = (R A C)⁻¹ = C⁻¹ A⁻¹ R⁻¹, A's inverse
+    with the equilibration undone, from a few solves with B and Bᴴ.  It
+    is nearly always exact, and never more than the true norm.
+ ***/
+
+template<typename T> double
+LUFactor::invNorm ()
+{
+  T *x = arenaArray<T> (dim);
+  T *y = arenaArray<T> (dim);
+  for (int i = 0; i < dim; i++) x[i] = 1.0 / dim;
+
+  double est = 0.0;
+  for (int iter = 0; iter < 5; iter++) {
+    for (int i = 0; i < dim; i++) y[i] = x[i] / rscale[i];
+    solveVec (y, false);
+    double norm = 0.0;
+    for (int i = 0; i < dim; i++) {
+      y[i] /= cscale[i];
+      norm += abs (y[i]);
+    }
+    if (iter > 0 && norm <= est) break;
+    est = norm;
+
+    for (int i = 0; i < dim; i++) {	// z = Bᴴ sign (y)
+      double m = abs (y[i]);
+      y[i] = ((m > 0.0) ? y[i] / m : T (1.0)) / cscale[i];
+    }
+    solveVec (y, true);
+    int j = 0;
+    double zx = 0.0;
+    for (int i = 0; i < dim; i++) {
+      y[i] /= rscale[i];
+      zx += real (conjv (y[i]) * x[i]);
+      if (abs (y[i]) > abs (y[j])) j = i;
+    }
+    if (abs (y[j]) <= zx) break;
+    for (int i = 0; i < dim; i++) x[i] = (i == j) ? 1.0 : 0.0;
+  }
+  return est;
+}
+
+/***
+    The reciprocal of the 1-norm condition number of the equilibrated
+    matrix, 0 if it's exactly singular.  Being equilibrated first, a
+    matrix that is merely badly scaled, such as 2 2⍴1E20 0 0 1, has an
+    rcond of 1.
+ ***/
+
+double
+LUFactor::rcond ()
+{
+  if (is_singular ()) return 0.0;
+  double inv = lu ? invNorm<double> () : invNorm<complex<double>> ();
+  return 1.0 / (anorm * inv);
+}
+
+bool
+LUFactor::is_ill_conditioned ()
+{
+  return rcond () < DBL_EPSILON;
+}
+
+/***
+    The determinant, exactly 0 when is_singular () says so, which is also
+    what phase () and lndet () go by, so that logdet is always d in log
+    form.
+ ***/
+
+complex<double>
+LUFactor::det ()
+{
+  if (is_singular ())
+    return complex<double> (0.0, 0.0);
+  if (lu)
+    return complex<double> (gsl_linalg_LU_det (lu, signum), 0.0);
+  gsl_complex z = gsl_linalg_complex_LU_det (clu, signum);
+  return complex<double> (GSL_REAL (z), GSL_IMAG (z));
+}
+
+/***
+    The sign (real) or unit phase (complex) of the determinant, 0.0 if the
+    matrix is singular.
+ ***/
+
+complex<double>
+LUFactor::phase ()
+{
+  if (is_singular ())
+    return complex<double> (0.0, 0.0);
+  if (lu)
+    return complex<double> ((double)gsl_linalg_LU_sgndet (lu, signum), 0.0);
+  gsl_complex z = gsl_linalg_complex_LU_sgndet (clu, signum);
+  return complex<double> (GSL_REAL (z), GSL_IMAG (z));
+}
+
+/***
+    log |det|, computed as the sum of the logs of the pivots so that it
+    doesn't overflow for large matrices.
+ ***/
+
+double
+LUFactor::lndet ()
+{
+  if (is_singular ())
+    return -INFINITY;
+  return lu ? gsl_linalg_LU_lndet (lu) : gsl_linalg_complex_LU_lndet (clu);
+}
+
+/***
+    Overwrites the rhs (n × k) with the solution x of A x = rhs, all k
+    columns at once by two triangular BLAS-3 solves.  A complex rhs against
+    a real factorisation is solved as 2k real columns.  The caller must
+    check is_ill_conditioned () first, and a real rhs needs a real
+    factorisation.
+ ***/
+
+void
+LUFactor::solve (RMatrix *rhs)
+{
+  int nrhs = rhs->cols ();
+  gsl_matrix_view xv =
+    gsl_matrix_view_array (arenaArray<double> (dim * nrhs), dim, nrhs);
+  gsl_matrix *x = &xv.matrix;
+  for (int r = 0; r < dim; r++) {
+    size_t pr = gsl_permutation_get (perm, r);
+    memcpy (x->data + r * nrhs, rhs->row (pr), nrhs * sizeof(double));
+  }
+  gsl_blas_dtrsm (CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
+		  1.0, lu, x);
+  gsl_blas_dtrsm (CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit,
+		  1.0, lu, x);
+  memcpy (rhs->data (), x->data, dim * nrhs * sizeof(double));
+}
+
+void
+LUFactor::solve (CMatrix *rhs)
+{
+  int nrhs = rhs->cols ();
+  
+  if (lu) {
+    bool cpx = !rhs->is_real ();
+    int xcols = cpx ? 2 * nrhs : nrhs;
+    gsl_matrix_view xv =
+      gsl_matrix_view_array (arenaArray<double> (dim * xcols), dim, xcols);
+    gsl_matrix *x = &xv.matrix;
+    for (int r = 0; r < dim; r++) {
+      size_t pr = gsl_permutation_get (perm, r);
+      for (int c = 0; c < nrhs; c++) {
+	complex<double> v = rhs->val (pr, c);
+	gsl_matrix_set (x, r, c, v.real ());
+	if (cpx) gsl_matrix_set (x, r, nrhs + c, v.imag ());
+      }
+    }
+    gsl_blas_dtrsm (CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
+		    1.0, lu, x);
+    gsl_blas_dtrsm (CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit,
+		    1.0, lu, x);
+    for (int r = 0; r < dim; r++) {
+      for (int c = 0; c < nrhs; c++) {
+	complex<double> v (gsl_matrix_get (x, r, c),
+			   cpx ? gsl_matrix_get (x, r, nrhs + c) : 0.0);
+	rhs->val (r, c, v);
+      }
+    }
+  }
+  else {
+    gsl_matrix_complex_view xv =
+      gsl_matrix_complex_view_array (arenaArray<double> (2 * dim * nrhs),
+				     dim, nrhs);
+    gsl_matrix_complex *x = &xv.matrix;
+    for (int r = 0; r < dim; r++) {
+      size_t pr = gsl_permutation_get (perm, r);
+      for (int c = 0; c < nrhs; c++) {
+	complex<double> v = rhs->val (pr, c);
+	gsl_complex z;
+	GSL_SET_COMPLEX (&z, v.real (), v.imag ());
+	gsl_matrix_complex_set (x, r, c, z);
+      }
+    }
+    gsl_complex one;
+    GSL_SET_COMPLEX (&one, 1.0, 0.0);
+    gsl_blas_ztrsm (CblasLeft, CblasLower, CblasNoTrans, CblasUnit,
+		    one, clu, x);
+    gsl_blas_ztrsm (CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit,
+		    one, clu, x);
+    for (int r = 0; r < dim; r++) {
+      for (int c = 0; c < nrhs; c++) {
+	gsl_complex z = gsl_matrix_complex_get (x, r, c);
+	rhs->val (r, c, complex<double> (GSL_REAL (z), GSL_IMAG (z)));
+      }
+    }
+  }
+}
+
+/***
+    Returns a new Matrix holding the inverse.  The caller must check
+    is_ill_conditioned () first, and Matrix<double> needs a real
+    factorisation.
+ ***/
+
+template<> RMatrix *
+LUFactor::inverse ()
+{
+  RMatrix *inv = new RMatrix (dim, dim);
+  gsl_matrix_view xv = gsl_matrix_view_array (inv->data (), dim, dim);
+  gsl_linalg_LU_invert (lu, perm, &xv.matrix);
+  return inv;
+}
+
+template<> CMatrix *
+LUFactor::inverse ()
+{
+  CMatrix *inv = new CMatrix (dim, dim);
+  
+  if (lu) {
+    gsl_matrix_view xv =
+      gsl_matrix_view_array (arenaArray<double> (dim * dim), dim, dim);
+    gsl_matrix *x = &xv.matrix;
+    gsl_linalg_LU_invert (lu, perm, x);
+    for (int r = 0; r < dim; r++) {
+      for (int c = 0; c < dim; c++)
+	inv->val (r, c, complex<double> (gsl_matrix_get (x, r, c), 0.0));
+    }
+  }
+  else {
+    gsl_matrix_complex_view xv =
+      gsl_matrix_complex_view_array (arenaArray<double> (2 * dim * dim),
+				     dim, dim);
+    gsl_matrix_complex *x = &xv.matrix;
+    gsl_linalg_complex_LU_invert (clu, perm, x);
+    for (int r = 0; r < dim; r++) {
+      for (int c = 0; c < dim; c++) {
+	gsl_complex z = gsl_matrix_complex_get (x, r, c);
+	inv->val (r, c, complex<double> (GSL_REAL (z), GSL_IMAG (z)));
+      }
+    }
+  }
+  return inv;
+}
+
+template<typename T> complex<double>
+getDet (Matrix<T> *mtx)
+{
+  LUFactor lu (mtx);
+  return lu.det ();
+}
+
+template<typename T> void
+getLogDet (Matrix<T> *mtx, complex<double> &phase, double &lndet)
+{
+  LUFactor lu (mtx);
+  phase = lu.phase ();
+  lndet = lu.lndet ();
+}
+
+template complex<double> getDet (RMatrix *mtx);
+template complex<double> getDet (CMatrix *mtx);
+template void getLogDet (RMatrix *mtx, complex<double> &phase, double &lndet);
+template void getLogDet (CMatrix *mtx, complex<double> &phase, double &lndet);
+
+/***
+    Exact determinant of an integer matrix, stored row-major in mtx (which
+    is overwritten), by fraction-free Bareiss elimination.  Every division
+    in the elimination is exact and the intermediate products are formed
+    in 128 bits.  Returns false if any intermediate value won't fit in 64
+    bits, in which case the caller should fall back to getDet ().  Every
+    value, given or intermediate, is kept within ±INT64_MAX, which keeps
+    the difference of two products inside 128 bits; INT64_MIN itself
+    would let it reach 2¹²⁷.
+ ***/
+
+bool
+getIntDet (int64_t *mtx, int dim, int64_t &det)
+{
+  int sign = 1;
+  __int128 prev = 1;
+
+  for (int i = 0; i < dim * dim; i++)
+    if (mtx[i] == INT64_MIN) return false;
+  
+  for (int k = 0; k < dim - 1; k++) {
+    if (mtx[k * dim + k] == 0) {
+      int p = k + 1;
+      while (p < dim && mtx[p * dim + k] == 0) p++;
+      if (p == dim) {
+	det = 0;
+	return true;
+      }
+      for (int c = k; c < dim; c++)
+	swap (mtx[k * dim + c], mtx[p * dim + c]);
+      sign = -sign;
+    }
+    __int128 pivot = mtx[k * dim + k];
+    for (int r = k + 1; r < dim; r++) {
+      __int128 lead = mtx[r * dim + k];
+      for (int c = k + 1; c < dim; c++) {
+	__int128 v = (pivot * mtx[r * dim + c] - lead * mtx[k * dim + c]) / prev;
+	if (v > INT64_MAX || v < -INT64_MAX) return false;
+	mtx[r * dim + c] = (int64_t)v;
+      }
+    }
+    prev = pivot;
+  }
+
+  __int128 d = sign * (__int128)mtx[dim * dim - 1];
+  if (d > INT64_MAX || d < INT64_MIN) return false;
+  det = (int64_t)d;
+  return true;
+}
+
+/***
+    Generalised cross product of the dim-1 vectors of length dim stored
+    row-major in vecs, i.e., the vector whose kth element is (¯1)*k times
+    the determinant of vecs with column k removed.  vecs is used as scratch.
+
+    The 3-D case is done in closed form.  Otherwise vecs is reduced once
+    by Gaussian elimination with column pivoting, leaving one free column;
+    the product is the null vector of the reduced rows, scaled by the
+    determinant of the pivot columns.  That's O(dim³) in total instead of
+    dim determinants.
+ ***/
+
+template<typename T> void
+getCross (T *vecs, int dim, T *cross)
+{
+  if (dim == 3) {
+    T *a = vecs;
+    T *b = vecs + 3;
+    cross[0] = a[1] * b[2] - a[2] * b[1];
+    cross[1] = a[2] * b[0] - a[0] * b[2];
+    cross[2] = a[0] * b[1] - a[1] * b[0];
+    return;
+  }
+
+  int rows = dim - 1;
+  int *perm = arenaArray<int> (dim);
+  for (int c = 0; c < dim; c++) perm[c] = c;
+  double sign = 1.0;
+  T pdet = 1.0;
+
+  for (int i = 0; i < rows; i++) {
+    T *ri = vecs + i * dim;
+    int p = i;
+    for (int c = i + 1; c < dim; c++)
+      if (abs (ri[c]) > abs (ri[p])) p = c;
+    if (ri[p] == 0.0) {			// rank deficient
+      for (int c = 0; c < dim; c++) cross[c] = 0.0;
+      return;
+    }
+    if (p != i) {
+      for (int r = 0; r < rows; r++)
+	swap (vecs[r * dim + i], vecs[r * dim + p]);
+      swap (perm[i], perm[p]);
+      sign = -sign;
+    }
+    pdet *= ri[i];
+    for (int r = i + 1; r < rows; r++) {
+      T *rr = vecs + r * dim;
+      T f = rr[i] / ri[i];
+      for (int c = i + 1; c < dim; c++) rr[c] -= f * ri[c];
+    }
+  }
+
+  // null vector with a 1 in the free column, back-substituted
+  T *y = arenaArray<T> (dim);
+  y[rows] = 1.0;
+  for (int i = rows - 1; i >= 0; i--) {
+    T *ri = vecs + i * dim;
+    T sum = 0.0;
+    for (int c = i + 1; c < dim; c++) sum += ri[c] * y[c];
+    y[i] = -sum / ri[i];
+  }
+
+  /***
+      The element in the free column is (¯1)*free × det of the remaining
+      columns in their original order, which works out to
+      (¯1)*(dim-1) × sign(perm) × the product of the pivots.
+   ***/
+  T scale = pdet * sign * ((rows % 2) ? -1.0 : 1.0);
+  for (int c = 0; c < dim; c++)
+    cross[perm[c]] = scale * y[c];
+}
+
+template void getCross (double *vecs, int dim, double *cross);
+template void getCross (complex<double> *vecs, int dim,
+			complex<double> *cross);
+
+bool
+getCholesky (RMatrix *mtx)
+{
+  gsl_matrix_view mv =
+    gsl_matrix_view_array (mtx->data (), mtx->rows (), mtx->cols ());
+  return gsl_linalg_cholesky_decomp1 (&mv.matrix) == GSL_SUCCESS;
+}
+
+void
+correlate (RMatrix *chol, double *z, int n)
+{
+  int dim = chol->rows ();
+  gsl_matrix_view lv = gsl_matrix_view_array (chol->data (), dim, dim);
+  gsl_matrix_view zv = gsl_matrix_view_array (z, n, dim);
+  gsl_blas_dtrmm (CblasRight, CblasLower, CblasTrans, CblasNonUnit,
+		  1.0, &lv.matrix, &zv.matrix);
+}
+
+template<typename T> static void
+centreRows (T *x, int rows, int cols, T *mean)
+{
+  for (int r = 0; r < rows; r++) {
+    T *row = x + r * cols;
+    T sum = 0.0;
+    for (int c = 0; c < cols; c++) sum += row[c];
+    sum /= (double)cols;
+    for (int c = 0; c < cols; c++) row[c] -= sum;
+    if (mean) mean[r] = sum;
+  }
+}
+
+template<> void
+getCoMoments (double *x, int rows, int cols, double alpha,
+	      double *mean, double *m2)
+{
+  centreRows (x, rows, cols, mean);
+  gsl_matrix_view xv = gsl_matrix_view_array (x, rows, cols);
+  gsl_matrix_view mv = gsl_matrix_view_array (m2, rows, rows);
+  gsl_blas_dsyrk (CblasLower, CblasNoTrans, alpha,
+		  &xv.matrix, 0.0, &mv.matrix);
+  for (int r = 0; r < rows; r++)
+    for (int c = r + 1; c < rows; c++)
+      m2[r * rows + c] = m2[c * rows + r];
+}
+
+template<> void
+getCoMoments (complex<double> *x, int rows, int cols, double alpha,
+	      complex<double> *mean, complex<double> *m2)
+{
+  centreRows (x, rows, cols, mean);
+  gsl_matrix_complex_view xv =
+    gsl_matrix_complex_view_array ((double *)x, rows, cols);
+  gsl_matrix_complex_view mv =
+    gsl_matrix_complex_view_array ((double *)m2, rows, rows);
+  gsl_blas_zherk (CblasLower, CblasNoTrans, alpha,
+		  &xv.matrix, 0.0, &mv.matrix);
+  for (int r = 0; r < rows; r++)
+    for (int c = r + 1; c < rows; c++)
+      m2[r * rows + c] = conj (m2[c * rows + r]);
+}
+
+RMatrix *
+getCovariance (RMatrix *data)
+{
+  const int rows = data->rows ();
+  const int cols = data->cols ();
+  RMatrix *cov = new RMatrix (rows, rows);
+  getCoMoments (data->data (), rows, cols, 1.0 / (cols - 1),
+		(double *)nullptr, cov->data ());
+  return cov;
+}
+
+CMatrix *
+getCovariance (CMatrix *data)
+{
+  const int rows = data->rows ();
+  const int cols = data->cols ();
+  CMatrix *cov = new CMatrix (rows, rows);
+
+  if (data->is_real ()) {
+    double *x = arenaArray<double> (rows * cols);
+    double *c = arenaArray<double> (rows * rows);
+    for (int i = 0; i < rows * cols; i++) x[i] = data->data ()[i].real ();
+    getCoMoments (x, rows, cols, 1.0 / (cols - 1), (double *)nullptr, c);
+    for (int i = 0; i < rows * rows; i++) cov->data ()[i] = c[i];
+  }
+  else
+    getCoMoments (data->data (), rows, cols, 1.0 / (cols - 1),
+		  (complex<double> *)nullptr, cov->data ());
+  return cov;
+}
+
+void
+project (CMatrix *comps, double *xc, int n, double *scores)
+{
+  const int k = comps->rows ();
+  const int d = comps->cols ();
+  double *v = arenaArray<double> (k * d);
+  for (int i = 0; i < k * d; i++) v[i] = comps->data ()[i].real ();
+  gsl_matrix_view vv = gsl_matrix_view_array (v, k, d);
+  gsl_matrix_view xv = gsl_matrix_view_array (xc, d, n);
+  gsl_matrix_view sv = gsl_matrix_view_array (scores, k, n);
+  gsl_blas_dgemm (CblasNoTrans, CblasNoTrans, 1.0,
+		  &vv.matrix, &xv.matrix, 0.0, &sv.matrix);
+}
+
+void
+project (CMatrix *comps, complex<double> *xc, int n, complex<double> *scores)
+{
+  const int k = comps->rows ();
+  const int d = comps->cols ();
+  complex<double> *v = comps->data ();
+  for (int i = 0; i < k * d; i++) v[i] = conj (v[i]);
+  gsl_matrix_complex_view vv =
+    gsl_matrix_complex_view_array ((double *)v, k, d);
+  gsl_matrix_complex_view xv =
+    gsl_matrix_complex_view_array ((double *)xc, d, n);
+  gsl_matrix_complex_view sv =
+    gsl_matrix_complex_view_array ((double *)scores, k, n);
+  gsl_complex one, zero;
+  GSL_SET_COMPLEX (&one, 1.0, 0.0);
+  GSL_SET_COMPLEX (&zero, 0.0, 0.0);
+  gsl_blas_zgemm (CblasNoTrans, CblasNoTrans, one,
+		  &vv.matrix, &xv.matrix, zero, &sv.matrix);
+}
+
+/***
+    Makes the rows of the rows × cols x orthonormal, by modified Gram-
+    Schmidt done twice over, which is as good as Householder for this.  A
+    row that's (numerically) in the span of those before it is zeroed.
+ ***/
+
+static void
+orthonormalRows (double *x, int rows, int cols)
+{
+  for (int r = 0; r < rows; r++) {
+    double *xr = x + r * cols;
+    double before = sqrt (vecSumSq (xr, cols));
+    for (int pass = 0; pass < 2; pass++)
+      for (int p = 0; p < r; p++) {
+	const double *xp = x + p * cols;
+	vecAxpy (-vecDot (xp, xr, cols), xp, xr, cols);
+      }
+    double after = sqrt (vecSumSq (xr, cols));
+    if (after <= 1e-12 * before || after == 0.0)
+      memset (xr, 0, cols * sizeof(double));
+    else
+      vecScale (xr, 1.0 / after, cols);
+  }
+}
+
+void
+randomSvd (double *a, int m, int n, int k, int q,
+	   double *s, double *u, double *v)
+{
+  const int l = min (k + 10, min (m, n));
+  double *om = arenaArray<double> (n * l);
+  double *qt = arenaArray<double> (l * m);	// range basis, as rows
+  double *zt = arenaArray<double> (l * n);
+  fillNormals (om, n * l, newStream (), 0);
+
+  gsl_matrix_view av  = gsl_matrix_view_array (a, m, n);
+  gsl_matrix_view omv = gsl_matrix_view_array (om, n, l);
+  gsl_matrix_view qv  = gsl_matrix_view_array (qt, l, m);
+  gsl_matrix_view zv  = gsl_matrix_view_array (zt, l, n);
+
+  // Qᵀ = (A Ω)ᵀ, then (Aᵀ Q)ᵀ and (A Z)ᵀ alternately for the power steps
+  gsl_blas_dgemm (CblasTrans, CblasTrans, 1.0,
+		  &omv.matrix, &av.matrix, 0.0, &qv.matrix);
+  orthonormalRows (qt, l, m);
+  for (int i = 0; i < q; i++) {
+    gsl_blas_dgemm (CblasNoTrans, CblasNoTrans, 1.0,
+		    &qv.matrix, &av.matrix, 0.0, &zv.matrix);
+    orthonormalRows (zt, l, n);
+    gsl_blas_dgemm (CblasNoTrans, CblasTrans, 1.0,
+		    &zv.matrix, &av.matrix, 0.0, &qv.matrix);
+    orthonormalRows (qt, l, m);
+  }
+
+  // B = Qᵀ A, l × n, decomposed as Bᵀ = U' S V'ᵀ, since Jacobi wants n ≥ l
+  gsl_blas_dgemm (CblasNoTrans, CblasNoTrans, 1.0,
+		  &qv.matrix, &av.matrix, 0.0, &zv.matrix);
+  double *bt = arenaArray<double> (n * l);
+  for (int r = 0; r < l; r++)
+    for (int c = 0; c < n; c++) bt[c * l + r] = zt[r * n + c];
+  double *vp = arenaArray<double> (l * l);
+  double *sv = arenaArray<double> (l);
+  gsl_matrix_view btv = gsl_matrix_view_array (bt, n, l);
+  gsl_matrix_view vpv = gsl_matrix_view_array (vp, l, l);
+  gsl_vector_view svv = gsl_vector_view_array (sv, l);
+  gsl_linalg_SV_decomp_jacobi (&btv.matrix, &vpv.matrix, &svv.vector);
+
+  // left vectors are the columns of Q V', so the rows of V'ᵀ Qᵀ
+  double *ut = arenaArray<double> (l * m);
+  gsl_matrix_view utv = gsl_matrix_view_array (ut, l, m);
+  gsl_blas_dgemm (CblasTrans, CblasNoTrans, 1.0,
+		  &vpv.matrix, &qv.matrix, 0.0, &utv.matrix);
+
+  memcpy (s, sv, k * sizeof(double));
+  memcpy (u, ut, k * m * sizeof(double));
+  for (int r = 0; r < k; r++)
+    for (int c = 0; c < n; c++) v[r * n + c] = bt[c * l + r];
+}
@@ -0,0 +1,147 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include<complex>
+#include<cstdint>
+#include<vector>
+
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_permutation.h>
+
+#include "Matrix.hh"
+
+/***
+    Partially pivoted LU factorisation of a square Matrix.  If every
+    element of the matrix is real the factorisation is done in real
+    arithmetic, otherwise in complex.  Once factored, the same LU can be
+    used for the determinant, for solving against any number of right-hand
+    sides, and for the inverse.  All of its storage is in the call's Arena,
+    and where the types allow the factorisation is done in place in the
+    matrix's own storage, which is overwritten.
+
+    is_singular () means an exact zero pivot, as for the determinant, so
+    that logdet is always d in log form.  is_ill_conditioned () is the
+    test for inverse and solve:  singular, or with an estimated reciprocal
+    condition number below ε once the rows and columns are equilibrated,
+    so that it doesn't depend on how they happen to be scaled.
+ ***/
+
+class LUFactor
+{
+public:
+  LUFactor (RMatrix *mtx);
+  LUFactor (CMatrix *mtx);
+  ~LUFactor ();
+  bool is_singular ();
+  bool is_ill_conditioned ();
+  double rcond ();
+  complex<double> det ();
+  complex<double> phase ();
+  double lndet ();
+  void solve (RMatrix *rhs);
+  void solve (CMatrix *rhs);
+  template<typename T> Matrix<T> *inverse ();
+  
+private:
+  void init (int n);
+  template<typename T> void equilibrate (Matrix<T> *mtx);
+  void solveVec (double *v, bool trans);
+  void solveVec (complex<double> *v, bool trans);
+  template<typename T> double invNorm ();
+  int dim;
+  int signum;
+  double *rscale;	// row and column equilibration, for rcond ()
+  double *cscale;
+  double  anorm;	// 1-norm of the equilibrated matrix
+  gsl_permutation         permv;
+  gsl_matrix_view         luv;
+  gsl_matrix_complex_view cluv;
+  gsl_permutation    *perm;
+  gsl_matrix         *lu;
+  gsl_matrix_complex *clu;
+};
+
+template<typename T> complex<double> getDet (Matrix<T> *mtx);
+template<typename T>
+void getLogDet (Matrix<T> *mtx, complex<double> &phase, double &lndet);
+bool getIntDet (int64_t *mtx, int dim, int64_t &det);
+template<typename T> void getCross (T *vecs, int dim, T *cross);
+
+/***
+    Cholesky factorisation, in place, of a symmetric positive definite
+    Matrix into the lower triangular L with L Lᵀ = mtx; only the lower
+    triangle of mtx is read.  Returns false if mtx isn't positive
+    definite.  correlate () then overwrites the n rows of z, each a vector
+    of independent standard normals, with z Lᵀ, so that each row has
+    covariance mtx.
+ ***/
+
+bool getCholesky (RMatrix *mtx);
+void correlate (RMatrix *chol, double *z, int n);
+
+/***
+    The rows × rows sample covariance of the rows of data, each row being
+    the samples of one variable:  one pass to centre the rows, in place,
+    and then a single rank-k update, Xc Xcᴴ / (cols - 1), by dsyrk, or by
+    zherk if data has a non-zero imaginary part.  data must have at least
+    two columns.
+ ***/
+
+RMatrix *getCovariance (RMatrix *data);
+CMatrix *getCovariance (CMatrix *data);
+
+/***
+    The centring and rank-k update behind getCovariance () on their own:
+    centres the rows × cols x in place, stores the row means in mean
+    unless it's null, and sets the rows × rows m2 to alpha Xc Xcᴴ.  With
+    alpha 1, m2 is the matrix of sums of co-deviations, which is what the
+    streaming accumulators merge.
+ ***/
+
+template<typename T>
+void getCoMoments (T *x, int rows, int cols, double alpha, T *mean, T *m2);
+
+/***
+    The k × n scores of the d × n centred data xc on the k orthonormal
+    components in the rows of comps, each the inner product with the
+    component, conj (comps) +.× xc, by one BLAS-3 multiply.  comps is
+    conjugated in place.
+ ***/
+
+void project (CMatrix *comps, double *xc, int n, double *scores);
+void project (CMatrix *comps, complex<double> *xc, int n,
+	      complex<double> *scores);
+
+/***
+    The k largest singular values of the m × n a, into s, and their left
+    and right singular vectors, into the rows of the k × m u and k × n v,
+    by the randomised range finder of Halko, Martinsson and Tropp:  a is
+    multiplied by an n × l gaussian matrix, l = k plus some oversampling,
+    the range so sampled is sharpened by q power iterations, and a is
+    projected onto it for an l × n SVD.  Nothing bigger than (m + n) × l
+    is ever formed besides a itself, which isn't changed.  Past the rank
+    of a the values come out 0 and the vectors all zeros.
+ ***/
+
+void randomSvd (double *a, int m, int n, int k, int q,
+		double *s, double *u, double *v);
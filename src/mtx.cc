@@ -35,7 +35,6 @@
 #undef PACKAGE_VERSION
 #undef VERSION
 
-#include<alloca.h>
 #include<strings.h>
 #include<cmath>
 #include<complex>
@@ -43,8 +42,9 @@
 #include<iostream>
 #include<fstream>
 #include<string>
+#include<cstring>
 
-#include <gsl/gsl_statistics.h>
+#include <gsl/gsl_errno.h>
 
 #include "Native_interface.hh"
 #include "APL_types.hh"
@@ -52,6 +52,13 @@
 #include "Value.hh"
 
 #include "eigens.hh"
+#include "linalg.hh"
+#include "arena.hh"
+#include "covacc.hh"
+#include "pool.hh"
+#include "rng.hh"
+#include "ravel.hh"
+#include "simd.hh"
 
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
@@ -79,30 +86,52 @@ enum {
   OP_NORM,
   OP_GAUSSIAN,
   OP_PRINT,
-  OP_COVARIANCE
+  OP_COVARIANCE,
+  OP_LOGDET,
+  OP_SOLVE,
+  OP_INVERSE,
+  OP_EIGENSYSTEM,
+  OP_ARENA,
+  OP_THREADS,
+  OP_SEED,
+  OP_MVN,
+  OP_ACC_OPEN,
+  OP_ACC_ADD,
+  OP_ACC_MERGE,
+  OP_ACC_COV,
+  OP_ACC_CORR,
+  OP_ACC_CLOSE,
+  OP_ROLLING_COV,
+  OP_PCA,
+  OP_SVD,
+  OP_LAST		// not an op; new ones go above
 };
 
 static bool
 close_fun(Cause cause, const NativeFunction * caller)
 {
-   return true;
+  poolClose ();
+  eigensClose ();
+  accCloseAll ();
+  return true;
 }
 
 bool (*close_fun_is_unused)(Cause, const NativeFunction *) = &close_fun;
 
+/***
+    A normally distributed value with standard deviations rsdev and isdev
+    for its real and imaginary parts, from this thread's engine.
+ ***/
+
 static complex<double>
 genRand (double rsdev, double isdev)
 {
-  random_device rrd;
-  random_device ird;
-  mt19937_64 rgen{rrd()};
-  mt19937_64 igen{ird()};
-  normal_distribution rd{0.0, rsdev};
-  normal_distribution id{0.0, isdev};
+  mt19937_64 &gen = rngEngine ();
+  normal_distribution<double> nd{0.0, 1.0};
 
-  complex<double> rc = complex (rd (rgen), id (igen));
-  
-  return rc;
+  double re = rsdev * nd (gen);
+  double im = (isdev != 0.0) ? isdev * nd (gen) : 0.0;
+  return complex<double> (re, im);
 }
 
 Fun_signature
@@ -133,139 +162,58 @@ eval_ident_Bx(Value_P B, sAxis x)
   return Token(TOK_APL_VALUE1, Str0(LOC));
 }
 
-static Matrix *
-genCofactor (Matrix *mtx, int r, int c)
-{
-  Matrix *cf = new Matrix (mtx->rows ()-1, mtx->cols ()-1);
-
-  int rx = 0;
-  for (int rr = 0; rr < mtx->rows (); rr++) {
-    if (rr != r) {
-      int cx = 0;
-      for (int cc = 0; cc < mtx->cols (); cc++) {
-	if (cc != c) {
-	  cf->val (rx, cx++, mtx->val (rr, cc));
-	}
-      }
-      rx++;
-    }
-  }
-
-  return cf;
-}
-
-static complex<double>
-getDet (Matrix *mtx)
-{	
-  complex<double> det (0.0, 0.0);
-  if (mtx->rows () == 2)
-    det = (mtx->val (0, 0) * mtx->val (1,1)) -
-	   (mtx->val (0, 1) * mtx->val (1,0));
-  else {
-    for (int k = 0; k < mtx->rows (); k++) {
-      double sign = pow (-1.0, (double)(k));
-      Matrix *cf = genCofactor (mtx, 0, k);
-      complex<double> id = getDet (cf);
-      delete cf;
-      det += sign * mtx->val (0, k) * id;
-    }
-  }
-
-  return det;
-}  
-
-static vector<complex<double>>
-getCross (Matrix *mtx)
-{
-      double data[] = { -1.0, 1.0, -1.0, 1.0,
-                    -8.0, 4.0, -2.0, 1.0,
-                    27.0, 9.0, 3.0, 1.0,
-                    64.0, 16.0, 4.0, 1.0 };
-
-  complex<double> det (0.0, 0.0);
-  vector<complex<double>> rc(mtx->cols ());
-  if (mtx->rows () == 2)
-    det = (mtx->val (0, 0) * mtx->val (1,1)) -
-	   (mtx->val (0, 1) * mtx->val (1,0));
-  else {
-    for (int k = 0; k < mtx->rows (); k++) {
-      double sign = pow (-1.0, (double)(k));
-      Matrix *cf = genCofactor (mtx, 0, k);
-      complex<double> id = getDet (cf);
-      delete cf;
-      rc[k] = sign * id;
-    }
-  }
-
-  return rc;
-}
-
-//https://misc.flogisoft.com/bash/tip_colors_and_formatting
+/***
+    Gaussian randoms with the standard deviations in B, in bulk.  The
+    normals come from a counter-based stream, each a function only of the
+    seed, the draw, and its index, so the pool fills them in chunks and a
+    seeded run gives the same result however many threads there are.  If
+    B has a complex element the result is complex, and a real element's
+    standard deviation then applies to both parts.
+ ***/
 
-static inline void
-showHelpLine (const char first, const char * rest)
-{
-  char *str;
-  if (first == 0)
-    asprintf (&str, "\t\e[4m%s\e[0m", rest);
-  else
-    asprintf (&str, "\t\e[4m%c\e[0m%s", first, rest);
-  cout << str << endl;
-  free (str);
-}
+#define RAND_CHUNK (1 << 16)		// even, so chunks don't split pairs
 
 static Value_P
 genRands (Value_P B)
 {
-  const ShapeItem count   = B->element_count();
-  Shape shape_Z;
-  shape_Z.add_shape_item(count);
-  Value_P rc = Value_P (shape_Z, LOC);
-
+  const ShapeItem count = B->element_count();
+  double *rsd = arenaArray<double> (count);
+  double *isd = arenaArray<double> (count);
   bool is_cpx = false;
-  for (int i = 0; i < count; i++) {
-    const Cell & Bv = B->get_cravel (i);
-    if (Bv.is_complex_cell () &&
-	Bv.get_imag_value () != 0.0) {
-      is_cpx = true;
-      break;
-    }
-  }
-  
-  for (int i = 0; i < count; i++) {
+  loop (i, count) {
     const Cell & Bv = B->get_cravel (i);
-    APL_Float xvr = Bv.get_real_value ();
-    APL_Float xvi = Bv.is_complex_cell ()
-      ? Bv.get_imag_value () : xvr;
-      complex<double> val = genRand (xvr, xvi);
-      if (is_cpx) 
-	(*rc).set_ravel_Complex (i, val.real (), val.imag ());
-      else
-	(*rc).set_ravel_Float (i, val.real ());
-  }
-  rc->check_value(LOC);
-  
-  const auto rank = B->get_rank();
-  Shape shape_W;
-  if (rank > 1) {
-    for (sAxis r = 0; r < rank; r++) {
-      ShapeItem s = B->get_shape_item (r);
-      shape_W.add_shape_item (s);
-    }
-    (*rc).set_shape (shape_W);
+    rsd[i] = Bv.get_real_value ();
+    isd[i] = Bv.is_complex_cell () ? Bv.get_imag_value () : rsd[i];
+    if (Bv.is_complex_cell () && isd[i] != 0.0) is_cpx = true;
   }
-  
-  return rc;
+
+  const size_t total  = is_cpx ? 2 * count : count;
+  const size_t chunks = (total + RAND_CHUNK - 1) / RAND_CHUNK;
+  const uint64_t stream = newStream ();
+  double *z = arenaArray<double> (total);
+  parallelFor (chunks, [&] (size_t c) {
+    const size_t start = c * RAND_CHUNK;
+    const size_t end   = min (start + RAND_CHUNK, total);
+    fillNormals (z + start, end - start, stream, start);
+    if (is_cpx)
+      for (size_t i = start; i < end; i++)
+	z[i] *= (i & 1) ? isd[i / 2] : rsd[i / 2];
+    else
+      for (size_t i = start; i < end; i++) z[i] *= rsd[i];
+  });
+
+  ResultBuilder rb (B->get_shape ());
+  if (is_cpx)
+    rb.put ((const complex<double> *)z);
+  else
+    rb.put (z);
+  return rb.get ();
 }
 
 static Value_P
 genRotation (int tp, Value_P A, Value_P B)
 {
-  Value_P rc;
-  Shape shape_Z;
   int sdim = (tp == 9) ? 3 : 4;
-  shape_Z.add_shape_item(tp);
-  rc = Value_P (shape_Z, LOC);
   vector<complex<double>> angs (3);
   for (int i = 0; i < 3; i++) {
     const Cell & Bv = B->get_cravel (i);
@@ -293,16 +241,15 @@ genRotation (int tp, Value_P A, Value_P B)
   complex<double>t21 =  cosb * sing;
   complex<double>t22 =  cosb * cosg;
 
+  Shape shape_W;
+  shape_W.add_shape_item (sdim);
+  shape_W.add_shape_item (sdim);
+  ResultBuilder rb (shape_W);
   if (tp == 9) {
-    (*rc).set_ravel_Complex (0,  t00.real (),  t00.imag ());
-    (*rc).set_ravel_Complex (1,  t01.real (),  t01.imag ());
-    (*rc).set_ravel_Complex (2,  t02.real (),  t02.imag ());
-    (*rc).set_ravel_Complex (3,  t10.real (),  t10.imag ());
-    (*rc).set_ravel_Complex (4,  t11.real (),  t11.imag ());
-    (*rc).set_ravel_Complex (5,  t12.real (),  t12.imag ());
-    (*rc).set_ravel_Complex (6,  t20.real (),  t20.imag ());
-    (*rc).set_ravel_Complex (7,  t21.real (),  t21.imag ());
-    (*rc).set_ravel_Complex (8,  t22.real (),  t22.imag ());
+    complex<double> z[9] = { t00, t01, t02,
+			     t10, t11, t12,
+			     t20, t21, t22 };
+    rb.put (z);
   }
   else {
     vector<complex<double>> trans (3);
@@ -313,796 +260,1768 @@ genRotation (int tp, Value_P A, Value_P B)
 			Av.is_complex_cell () ?
 			Av.get_imag_value () : 0.0);
     }
-    (*rc).set_ravel_Complex (0,   t00.real (),  t00.imag ());
-    (*rc).set_ravel_Complex (1,   t01.real (),  t01.imag ());
-    (*rc).set_ravel_Complex (2,   t02.real (),  t02.imag ());
-    (*rc).set_ravel_Complex (3,   0.0, 0.0);
-    
-    (*rc).set_ravel_Complex (4,   t10.real (),  t10.imag ());
-    (*rc).set_ravel_Complex (5,   t11.real (),  t11.imag ());
-    (*rc).set_ravel_Complex (6,   t12.real (),  t12.imag ());
-    (*rc).set_ravel_Complex (7,   0.0, 0.0);
-    
-    (*rc).set_ravel_Complex (8,   t20.real (),  t20.imag ());
-    (*rc).set_ravel_Complex (9,   t21.real (),  t21.imag ());
-    (*rc).set_ravel_Complex (10,  t22.real (),  t22.imag ());
-    (*rc).set_ravel_Complex (11,  0.0, 0.0);
-    
-    (*rc).set_ravel_Complex (12,  trans[0].real (), trans[0].imag ());
-    (*rc).set_ravel_Complex (13,  trans[1].real (), trans[1].imag ());
-    (*rc).set_ravel_Complex (14,  trans[2].real (), trans[2].imag ());
-    (*rc).set_ravel_Complex (15,  1.0, 0.0);
+    complex<double> z[16] = { t00, t01, t02, 0.0,
+			      t10, t11, t12, 0.0,
+			      t20, t21, t22, 0.0,
+			      trans[0], trans[1], trans[2], 1.0 };
+    rb.put (z);
   }
+  return rb.get ();
+}
+
+/***
+    Returns the two-element vector (phase, log |det|) so that the
+    determinant of a large matrix can be recovered as phase × *lndet
+    without overflowing.  The phase is ¯1, 0, or 1 for real matrices and
+    a unit complex for complex ones.
+ ***/
+
+template<typename T> static Value_P
+genLogDet (Matrix<T> *mtx)
+{
+  complex<double> phase;
+  double lndet;
+  getLogDet (mtx, phase, lndet);
   
-  rc->check_value(LOC);
   Shape shape_W;
-  shape_W.add_shape_item (sdim);
-  shape_W.add_shape_item (sdim);
-  (*rc).set_shape (shape_W);
-  return rc;
+  shape_W.add_shape_item(2);
+  ResultBuilder rb (shape_W);
+  if (phase.imag () == 0.0)
+    rb.set (0, phase.real ());
+  else
+    rb.set (0, phase);
+  rb.set (1, lndet);
+  return rb.get ();
 }
 
-static void
-Normalise (vector<double> &v)
+template<typename T> static Value_P
+genMatrix (Matrix<T> *mtx)
 {
-  double mean = gsl_stats_mean (v.data (), 1, v.size ());
-  double sdev = gsl_stats_sd_m(v.data (), 2, v.size (), mean);
-  loop (c, v.size ())
-    v[c] = (v[c] - mean) / sdev;
+  Shape shape_W;
+  shape_W.add_shape_item(mtx->rows ());
+  shape_W.add_shape_item(mtx->cols ());
+  ResultBuilder rb (shape_W);
+  rb.put (mtx->data ());
+  return rb.get ();
 }
 
-static Token
-eval_XB(Value_P X, Value_P B, const NativeFunction * caller)
+/***
+    The cross product of the dim-1 vectors of length dim in vecs (which is
+    used as scratch), real if possible.  Scratch for up to 7-space lives on
+    the stack, otherwise in the Arena.
+ ***/
+
+template<typename T> static Value_P
+genCross (T *vecs, int dim)
 {
-  Value_P rc = Str0(LOC);
-  
-  if (B->is_char_string ()) {
-    cout << "\n\tgeneral form: mtx['\e[3mindex\e[0m']\n\n";
-    cout << "\tvalid '\e[3mindex\e[0m' values: (underscored minimal)\n\n";
-    showHelpLine ('d', "eterminant");
-    showHelpLine ('c', "ross_product");
-    showHelpLine ('C', "ovariance");
-    showHelpLine ('i', "ident");
-    showHelpLine ('r', "otate");
-    showHelpLine ('n', "orm");
-    showHelpLine ('a', "ngle");
-    showHelpLine ('g', "rand");
-    showHelpLine ('p', "rint");
-    showHelpLine ('h', "omogeneous");
-    showHelpLine (0, "eigenvector");
-    showHelpLine (0, "eigenvalue");
-    cout << "\n\tdefaults to determinant if the index is omitted.\n\n";
-    return Token(TOK_APL_VALUE1, rc);
-  }
+  T csmall[7];
+  T *cp = (dim > 7) ? arenaArray<T> (dim) : csmall;
+  getCross (vecs, dim, cp);
   
-  int op = OP_UNKNOWN;
-  
-  if (X->is_char_string ()) {
-    const UCS_string  ustr = X->get_UCS_ravel();
-    UTF8_string which (ustr);
-    switch(*which.c_str ()) {
-    case 'd':						// working
-    case 'D': op = OP_DETERMINANT; break;
-    case 'c': op = OP_CROSS_PRODUCT; break;		// working
-    case 'C': op = OP_COVARIANCE; break;
-    case 'i':						// working
-    case 'I': op = OP_IDENT; break;
-    case 'r':						// working
-    case 'R': op = OP_ROTATION_MATRIX; break;
-    case 'n':						// working
-    case 'N': op = OP_NORM; break;
-    case 'g':						// working
-    case 'G': op = OP_GAUSSIAN; break;
-    }
-    if (op == OP_UNKNOWN) {
-      if (!strcasecmp (which.c_str (), "eigenvector"))
-	op = OP_EIGENVECTORS;
-      else if (!strcasecmp (which.c_str (), "eigenvalue"))
-	op = OP_EIGENVALUES;
-    }
-    if (op == OP_UNKNOWN) {
-      MORE_ERROR () << "Invalid mtx type specifoed";
-      SYNTAX_ERROR;
-    }
-  }
-  else if (X->is_numeric_scalar()) 
-    op = X->get_sole_integer ();
-
-  const CellType celltype = B->deep_cell_types();
-
-  if (celltype & CT_NUMERIC) {
-    const ShapeItem count   = B->element_count();
-    const auto      rank    = B->get_rank();
-    switch((int)rank) {
-    case 0:		// scalar
-      {
-	switch(op) {
-	case OP_GAUSSIAN:
-	  {
-	    const Cell & Bv = B->get_cravel (0);
-	    APL_Float xvr = Bv.get_real_value ();
-	    APL_Float xvi = Bv.is_complex_cell ()
-	      ? Bv.get_imag_value () : 0.0;
-	    complex<double> val = genRand (xvr, xvi);
-	    rc = (xvi == 0.0) ?
-	      FloatScalar (val.real (), LOC) :
-	      ComplexScalar (val.real (), val.imag (), LOC);
-	  }	
-	  break;
-	case OP_NORM:
-	  MORE_ERROR () << "Scalar argument.  Normalisation not posible.";
-	  RANK_ERROR;
-	  break;
-	case OP_ROTATION_MATRIX:
-	  {
-	    Shape shape_Z;
-	    shape_Z.add_shape_item(4);
-	    rc = Value_P (shape_Z, LOC);
-	    const Cell & Bv = B->get_cravel (0);
-	    APL_Float xvr = Bv.get_real_value ();
-	    APL_Float xvi = Bv.is_complex_cell ()
-	      ? Bv.get_imag_value () : 0.0;
-	    complex<double>theta (xvr, xvi);
-	    complex<double>cosx = cos (theta);
-	    complex<double>sinx = sin (theta);
-	    (*rc).set_ravel_Complex (0,  cosx.real (),  cosx.imag ());
-	    (*rc).set_ravel_Complex (1, -sinx.real (), -sinx.imag ());
-	    (*rc).set_ravel_Complex (2,  sinx.real (),  sinx.imag ());
-	    (*rc).set_ravel_Complex (3,  cosx.real (),  cosx.imag ());
-	    rc->check_value(LOC);
-	    Shape shape_W;
-	    shape_W.add_shape_item (2);
-	    shape_W.add_shape_item (2);
-	    (*rc).set_shape (shape_W);
-	  }
-	  break;
-	case OP_IDENT:
-	  {
-	    int dim = B->get_sole_integer();
-	    Shape shape_Z;
-	    shape_Z.add_shape_item(dim * dim);
-	    rc = Value_P (shape_Z, LOC);
-
-	    int p = 0;
-	    for (int i = 0; i < dim; i++) {
-	      for (int j = 0; j < dim; j++, p++) 
-		(*rc).set_ravel_Complex (p,
-					 ((i == j) ? 1.0 : 0.0),
-					 0.0);
-	    }
-	    rc->check_value(LOC);
-	    Shape shape_W;
-	    shape_W.add_shape_item (dim);
-	    shape_W.add_shape_item (dim);
-	    (*rc).set_shape (shape_W);
-	  }
-	  break;
-	default:
-	  MORE_ERROR () << "Invalid mtx type specifoed";
-	  DOMAIN_ERROR;
-	  break;
-	}
-      }
-      break;
-    case 1:		// vector --only count == 1 vectors will work for det
-      {
-	switch(op) {
-	case OP_GAUSSIAN:
-	  rc = genRands (B);
-	  break;
-	case OP_NORM:
-	  {
-	    complex<double> sum (0.0, 0.0);;
-	    for (int i = 0; i < count; i++) {
-	      const Cell & Bv = B->get_cravel (i);
-	      complex<double> val =
-		complex<double>(Bv.get_real_value (),
-				Bv.is_complex_cell () ?
-				Bv.get_imag_value () : 0.0);
-	      sum += val * val;
-	    }
-	    sum = sqrt (sum);
-
-	    Shape shape_Z;
-	    shape_Z.add_shape_item(count);
-	    rc = Value_P (shape_Z, LOC);
-
-	    for (int i = 0; i < count; i++) {
-	      const Cell & Bv = B->get_cravel (i);
-	      complex<double> val =
-		complex<double>(Bv.get_real_value (),
-				Bv.is_complex_cell () ?
-				Bv.get_imag_value () : 0.0);
-	      val /= sum;
-	      (*rc).set_ravel_Complex (i, val.real (), val.imag ());
-	    }
-	    rc->check_value(LOC);
-	  }
-	  break;
-	case OP_ROTATION_MATRIX:
-	  {
-	    if (count == 3)
-	      rc = genRotation (9, nullptr, B);
-	    else {
-	      MORE_ERROR () << "Argument must be a vector of length 3";
-	      RANK_ERROR;
-	    }
-	  }
-	  break;
-	case OP_DETERMINANT:
-	  if (B->is_empty ()) {
-	    MORE_ERROR () << "Null argument.";
-	    LENGTH_ERROR;
-	  }
-	  else {
-	    if (count == 1) {
-	      const Cell & Bx = B->get_cfirst ();
-	      APL_Float xvr = Bx.get_real_value ();
-	      if (Bx.is_complex_cell ()) {
-		APL_Float xvi = Bx.get_imag_value ();
-		rc = ComplexScalar(xvr, xvi, LOC);
-	      }
-	      else 
-		rc = FloatScalar(xvr, LOC);
-	    }
-	    else {
-	      MORE_ERROR () << "Vector argument.  No determinant posible.";
-	      LENGTH_ERROR;
-	    }
-	  }
-	  break;
-	default:
-	  MORE_ERROR () << "Unknown operation requested.";
-	  RANK_ERROR;
-	  break;
-	}
-      }
-      break;
-    case 2:		// matrix
-      {
-	if (B->is_empty ()) {
-	  MORE_ERROR () << "Null argument.";
-	  LENGTH_ERROR;	
-	}
-	
-	ShapeItem rows = B->get_shape_item(0);
-	ShapeItem cols = B->get_shape_item(1);
-
-	if (op != OP_CROSS_PRODUCT &&
-	    op != OP_GAUSSIAN &&
-	    op != OP_NORM &&
-	    op != OP_COVARIANCE &&
-	    rows != cols) {
-	  MORE_ERROR () << "Not a square matrix.";
-	  RANK_ERROR;
-	}
-
-	switch(op) {
-	case OP_COVARIANCE:
-	  {
-	    /***  split mtx into vecs by rows ***/
-	    vector<vector<double>> Breals (rows);
-	    vector<vector<double>> Bimags (rows);
-	    loop (r, rows) {
-	      Breals[r].reserve (cols);
-	      Bimags[r].reserve (cols);
-	      int offset = r * cols;
-	      loop (c, cols) {
-		const Cell & Bv = B->get_cravel (offset + c);
-		Breals[r][c] =
-		  Bv.get_real_value ();
-		Bimags[r][c] =
-		  Bv.is_complex_cell () ? Bv.get_imag_value () : 0.0;
-	      }
-	      Normalise (Breals[r]);
-	      Normalise (Bimags[r]);
-	    }
-	    Shape shape_Z;
-	    shape_Z.add_shape_item (rows * rows);
-	    rc = Value_P (shape_Z, LOC);
-	    for (int r = 0; r < rows; r++) {
-	      for (int c = r; c < rows; c++) {
-		double realcov = gsl_stats_covariance (Breals[r].data (), 1,
-						       Breals[c].data (), 1,
-						       cols);
-		double imagcov = gsl_stats_covariance (Bimags[r].data (), 1,
-						       Bimags[c].data (), 1,
-						       cols);
-		int ix = (r * rows) + c;
-		(*rc).set_ravel_Complex (ix,   realcov, imagcov);
-		if (r != c) {
-		  int ix = (c * rows) + r;
-		  (*rc).set_ravel_Complex (ix,   realcov, imagcov);
-		}
-	      }
-	    }
-	    rc->check_value(LOC);
-	    Shape shape_W;
-	    shape_W.add_shape_item(rows);
-	    shape_W.add_shape_item(rows);
-	    (*rc).set_shape (shape_W);
-	  }
-	  break;
-	case OP_NORM:
-	  {
-	    complex<double> sum (0.0, 0.0);;
-	    for (int i = 0; i < count; i++) {
-	      const Cell & Bv = B->get_cravel (i);
-	      complex<double> val =
-		complex<double>(Bv.get_real_value (),
-				Bv.is_complex_cell () ?
-				Bv.get_imag_value () : 0.0);
-	      sum += val * val;
-	    }
-	    sum = sqrt (sum);
-
-	    Shape shape_Z;
-	    shape_Z.add_shape_item(rows);
-	    shape_Z.add_shape_item(cols);
-	    rc = Value_P (shape_Z, LOC);
-
-	    for (int i = 0; i < count; i++) {
-	      const Cell & Bv = B->get_cravel (i);
-	      complex<double> val =
-		complex<double>(Bv.get_real_value (),
-				Bv.is_complex_cell () ?
-				Bv.get_imag_value () : 0.0);
-	      val /= sum;
-	      (*rc).set_ravel_Complex (i, val.real (), val.imag ());
-	    }
-	    rc->check_value(LOC);
-	  }
-	  break;
-	case OP_GAUSSIAN:
-	  rc = genRands (B);
-	  break;
-	case OP_CROSS_PRODUCT:
-	  rows++;
-	  if (rows != cols) {
-	    MORE_ERROR () << 
-	      "For cross product, the shape of the argument must be [n-1 n]";
-	    RANK_ERROR;
-	  }
-	}
-	
-	Matrix *mtx = new Matrix (rows, cols);
-
-	if (op != OP_GAUSSIAN) {
-	  int p = 0;
-
-	  loop (r, rows) {
-	    loop (c, cols) {
-	      if (op == OP_CROSS_PRODUCT && r == 0)
-		mtx->val (0, c, complex (1.0, 0.0));
-	      else {
-		const Cell & Bv = B->get_cravel (p++);
-		APL_Float xvr = Bv.get_real_value ();
-		APL_Float xvi = Bv.is_complex_cell ()
-		  ? Bv.get_imag_value () : 0.0;
-		mtx->val (r, c, complex (xvr, xvi));
-	      }
-	    }
-	  }
-	}
+  Shape shape_W;
+  shape_W.add_shape_item(dim);
+  ResultBuilder rb (shape_W);
+  rb.put (cp);
+  return rb.get ();
+}
 
-	switch(op) {
-	case OP_GAUSSIAN:	// do nothing
-	  break;
-	case OP_IDENT:
-	  MORE_ERROR () << "Must be a scalae argument.";
-	  RANK_ERROR;
-	  break;
-	case OP_EIGENVECTORS:
-	  {
-	    Matrix res = getEigenvectors (mtx);
-	    Shape shape_Z;
-	    shape_Z.add_shape_item(mtx->rows () * mtx->cols ());
-	    rc = Value_P (shape_Z, LOC);
-	    int p = 0;
-	    for (int i = 0; i < mtx->rows (); i++) {
-	      for (int j = 0; j < mtx->cols (); j++, p++) 
-		(*rc).set_ravel_Complex (p,
-					 res.val (i, j).real (),
-					 res.val (i, j).imag ());
-	    }
-	    rc->check_value(LOC);
-	    Shape shape_W;
-	    shape_W.add_shape_item(mtx->rows ());
-	    shape_W.add_shape_item(mtx->cols ());
-	    (*rc).set_shape (shape_W);
-	  }
-	  break;
-	case OP_EIGENVALUES:
-	  {
-	    vector<complex<double>> res = getEigenvalues (mtx);
-	    Shape shape_Z;
-	    shape_Z.add_shape_item(mtx->cols ());
-	    rc = Value_P (shape_Z, LOC);
-	    for (int i = 0; i < mtx->cols (); i++) 
-	      (*rc).set_ravel_Complex (i, res[i].real (), res[i].imag ());
-	    rc->check_value(LOC);
-	  }
-	  break;
-	case OP_DETERMINANT:
-	  {
-	    complex<double>det = getDet (mtx);
-	    rc = (det.imag () == 0.0) ?
-	      FloatScalar(det.real (), LOC) :
-	      ComplexScalar(det.real (), det.imag (), LOC);
-	    rc->check_value(LOC);
-	  }
-	  break;
-	case OP_CROSS_PRODUCT:
-	  {
-	    vector<complex<double>> cp = getCross (mtx);
-	    Shape shape_Z;
-	    shape_Z.add_shape_item(mtx->cols ());
-	    rc = Value_P (shape_Z, LOC);
-	    bool is_cpx = false;
-	    for (int i = 0; i < mtx->cols (); i++) {
-	      if (cp[i].imag () != 0.0) {
-		is_cpx = true;
-		break;
-	      }
-	    }
-	    for (int i = 0; i < mtx->cols (); i++) {
-	      if (is_cpx) 
-		(*rc).set_ravel_Complex (i, cp[i].real (), cp[i].imag ());
-	      else
-		(*rc).set_ravel_Float (i, cp[i].real ());
-	    }
-	    rc->check_value(LOC);
-	  }
-	  break;
-	}
+template<typename T> static Value_P
+genCross (Value_P B, int dim)
+{
+  T small[6 * 7];
+  T *vecs = (dim > 7) ? arenaArray<T> ((dim - 1) * dim) : small;
+  RavelView<T> (B, 0, dim - 1, dim).copy (vecs);
+  return genCross (vecs, dim);
+}
 
-	delete mtx;
-      }
-      break;
-    default:		// can't deal with it
-      if (op == OP_GAUSSIAN)
-	rc = genRands (B);
-      else {
-	MORE_ERROR () << "Argument must be scalar, vector, or matrix";
-	RANK_ERROR;
-      }
-      break;
-    }
-  }
-  else {				// not numeric
-    MORE_ERROR () << "Non-numeric argument.";
-    DOMAIN_ERROR;
-  }
+static inline double
+sumSquares (const double *x, int n)
+{
+  return vecSumSq (x, n);
+}
 
-  return Token(TOK_APL_VALUE1, rc);
+static inline complex<double>
+sumSquares (const complex<double> *x, int n)
+{
+  complex<double> sum = 0.0;
+  loop (i, n) sum += x[i] * x[i];
+  return sum;
 }
 
-static Token
-eval_B(Value_P B, const NativeFunction * caller)
+/***
+    The n elements of x divided by the square root of the sum of their
+    squares, into dst, which may be x.
+ ***/
+
+template<typename T, typename U> static void
+normalise (const T *x, int n, U *dst)
 {
-  Value_P X = IntScalar (OP_DETERMINANT, LOC);	// default to determinant
-  return eval_XB (X, B, caller);
+  T sum = sqrt (sumSquares (x, n));
+  loop (i, n) dst[i] = x[i] / sum;
 }
 
-static
-complex<double>
-magnitude (vector<complex<double>> &v)
+/***
+    B normalised, keeping its shape.
+ ***/
+
+template<typename T> static Value_P
+genNorm (Value_P B)
 {
-  complex<double> rc (0.0, 0.0);
-  loop (i, v.size ()) rc += v[i] * v[i];
-  rc = sqrt (rc);
-  return rc;
+  const ShapeItem count = B->element_count ();
+  T *vals = arenaArray<T> (count);
+  RavelView<T> (B, 0, 1, count).copy (vals);
+  normalise (vals, count, vals);
+
+  ResultBuilder rb (B->get_shape ());
+  rb.put (vals);
+  return rb.get ();
 }
 
-static Token
-eval_AXB(Value_P A, Value_P X, Value_P B,
-	 const NativeFunction * caller)
+/***
+    Results of the eigen ops for the k eigenpairs in vals and the rows of
+    vecs:  a vector of eigenvalues, a k × n matrix of eigenvectors, or, for
+    eigensystem, a (k+1) × n matrix whose first row is the eigenvalues and
+    whose remaining rows are the corresponding eigenvectors.
+ ***/
+
+static Value_P
+genEigens (int op, vector<complex<double>> &vals, CMatrix *vecs)
 {
-  int op = OP_UNKNOWN;
+  int k = vals.size ();
+  int n = vecs ? vecs->cols () : k;
+  int vrows = (op == OP_EIGENSYSTEM) ? 1 : 0;
+  int erows = (op == OP_EIGENVALUES) ? 0 : k;
   
-  if (X->is_char_string ()) {
-    const UCS_string  ustr = X->get_UCS_ravel();
-    UTF8_string which (ustr);
-    switch(*which.c_str ()) {
-    case 'a':						// working
-    case 'A': op = OP_VECTOR_ANGLE; break;
-    case 'C': op = OP_COVARIANCE; break;
-    case 'c': op = OP_CROSS_PRODUCT; break;		// working
-    case 'p':						// working
-    case 'P': op = OP_PRINT; break;
-    case 'h':						// working
-    case 'H': op = OP_HOMOGENEOUS_MATRIX; break;
-    }
-    if (op == OP_UNKNOWN) {
-      MORE_ERROR () << "Invalid mtx type specifoed";
-      SYNTAX_ERROR;
-    }
+  Shape shape_W;
+  if (op == OP_EIGENVALUES)
+    shape_W.add_shape_item(k);
+  else {
+    shape_W.add_shape_item(vrows + erows);
+    shape_W.add_shape_item(n);
   }
-  else if (X->is_numeric_scalar()) 
-    op = X->get_sole_integer ();
-
-  Value_P rc = Str0(LOC);
-  
-  const CellType A_celltype = A->deep_cell_types();
-  const CellType B_celltype = B->deep_cell_types();
-
-  if (op == OP_PRINT) {
-    if (A->is_char_string () &&
-	B->is_char_string ()) {
-      const UCS_string ustr = B->get_UCS_ravel();
-      UTF8_string fn (ustr);
-      char *fns = (char *)(fn.c_str ());
-      bool append = false;
-      if (strlen (fns) > 1) {
-	if (*fns == '>') {
-	  fns++;
-	  append = true;
-	}
-      }
-      FILE *ofile = append ?
-	fopen (fns, "a") :
-	fopen (fns, "w");
-
-      const UCS_string vstr = A->get_UCS_ravel();
-      UTF8_string val (vstr);
-      char *vs = (char *)(val.c_str ());
+  ResultBuilder rb (shape_W);
+  complex<double> *z = arenaArray<complex<double>> (shape_W.get_volume ());
+  int p = 0;
+  if (op != OP_EIGENVECTORS) {
+    for (int j = 0; j < k; j++) z[p++] = vals[j];
+    for (int j = k; vrows && j < n; j++)	// pad short value rows
+      z[p++] = 0.0;
+  }
+  if (erows)
+    memcpy (z + p, vecs->data (), erows * n * sizeof(complex<double>));
+  rb.put (z);
+  return rb.get ();
+}
 
-      fprintf (ofile, "%s\n", vs);
-      fclose (ofile);
+/***
+    GSL has no general complex eigensolver, so a complex argument to the
+    eigen ops has to be Hermitian, while a real one can be anything.
+    slice, if there is one, is where it was found in a stack.
+ ***/
 
-      return Token(TOK_APL_VALUE1, rc);
-    }
-    if ((A_celltype & CT_NUMERIC) &&
-	B->is_char_string ()) {
-      const ShapeItem A_count   = A->element_count();
-      const auto      A_rank    = A->get_rank();
-      const UCS_string  ustr = B->get_UCS_ravel();
-      UTF8_string fn (ustr);
-      char *fns = (char *)(fn.c_str ());
-      bool append = false;
-      if (strlen (fns) > 1) {
-	if (*fns == '>') {
-	  fns++;
-	  append = true;
-	}
-      }
-      FILE *ofile = append ?
-	fopen (fns, "a") :
-	fopen (fns, "w");
-      
-      if (!ofile) {
-	MORE_ERROR () << "Open failure on " << ustr;
-	DOMAIN_ERROR;
-      }
-      if (A_rank <= 1) {
-	for (int i = 0; i < A_count; i++) {
-	  const Cell & Av = A->get_cravel (i);
-	  APL_Float Avr = Av.get_real_value ();
-	  if (Av.is_complex_cell ()) {
-	    APL_Float Avi = Av.get_imag_value ();
-	    fprintf (ofile, "%gj%g ", Avr, Avi);
-	  }
-	  else
-	    fprintf (ofile, "%g ", Avr);
-	}
-	fprintf (ofile, "\n");
-      }
-      else {
-	int end_line = (int)(A->get_shape_item (A_rank-1));
-	int end_grid = end_line * (int)(A->get_shape_item (A_rank-2));
-#define STR_LEN 256
-	char str[STR_LEN];
-	bool is_cpx = false;
-	int max_len = -1;
-	for (int i = 0; i < A_count; i++) {
-	  int len;
-	  const Cell & Av = A->get_cravel (i);
-	  APL_Float Avr = Av.get_real_value ();
-	  if (Av.is_complex_cell ()) {
-	    APL_Float Avi = Av.get_imag_value ();
-	    len = snprintf (str, STR_LEN, "%gj%g", Avr, Avi);
-	    if (Avi != 0.0) is_cpx = true;
-	  }
-	  else
-	    len = snprintf (str, STR_LEN, "%g", Avr);
-	  if (max_len < len) max_len = len;
-	}
-	int *rho = (int *)alloca (A_rank * sizeof(int));
-	bzero (rho, A_rank * sizeof(int));
-	for (int i = 0; i < A_count; i++) {
-	  if (A_rank > 2) {
-	    if (0 == i%end_grid) {
-	      fprintf (ofile, "\n[");
-	      for (int j = 0; j < A_rank - 2; j++)
-		fprintf (ofile, "%d ", rho[j]);
-	      fprintf (ofile, "* *]:\n");
-	      bool carry = 1;
-	      for (int j = A_rank - 3; j >= 0; j--) {
-		rho[j] += carry;
-		if (rho[j] >= A->get_shape_item (j)) {
-		  rho[j] = 0;
-		  carry = 1;
-		}
-		else
-		  carry = 0;
-	      }
-	    }
-	  }
-	  const Cell & Av = A->get_cravel (i);
-	  APL_Float Avr = Av.get_real_value ();
-	  char str[STR_LEN];
-	  if (is_cpx && Av.is_complex_cell ()) {
-	    APL_Float Avi = Av.get_imag_value ();
-	    snprintf (str, STR_LEN, "%gj%g", Avr, Avi);
-	  }
-	  else
-	    snprintf (str, STR_LEN, "%g", Avr);
-	  fprintf (ofile, "%*s ", max_len, str);
-	  if (0 == (i+1)%end_line) fprintf (ofile, "\n");
-	}
-      }
+template<typename T> static void
+checkEigenArg (Matrix<T> *mtx, ShapeItem slice = -1)
+{
+  if (mtx->is_real () || isHermitian (mtx)) return;
+  MORE_ERROR () << "Eigen ops need a complex matrix to be Hermitian";
+  if (slice >= 0) MORE_ERROR () << " (slice " << slice << ")";
+  MORE_ERROR () << ".";
+  DOMAIN_ERROR;
+}
 
-      fclose (ofile);
-      return Token(TOK_APL_VALUE1, rc);
-    }
-    else {
-      MORE_ERROR () << "Incompatible arguments.";
-      DOMAIN_ERROR;
-    }
-  }
+/***
+    One slice of genBatch (), the rows × cols matrix at src, into dst.
+    The kernels work on src in place.  Runs on a pool thread, so mustn't
+    touch any APL value.  Returns false if an inverse was asked for and
+    the matrix is singular.
+ ***/
 
-  if ((A_celltype & CT_NUMERIC) &&
-      (B_celltype & CT_NUMERIC)) {
-  }
-  else {				// not numeric
-    MORE_ERROR () << "Non-numeric argument.";
-    DOMAIN_ERROR;
-  }
+template<typename T> static bool
+batchSlice (int op, T *src, int rows, int cols, complex<double> *dst)
+{
+  const int in_size = rows * cols;
   
-  const ShapeItem A_count   = A->element_count();
-  const auto      A_rank    = A->get_rank();
-  const ShapeItem B_count   = B->element_count();
-  const auto      B_rank    = B->get_rank();
+  if (op == OP_NORM) {
+    normalise (src, in_size, dst);
+    return true;
+  }
 
+  Matrix<T> *mtx = new Matrix<T> (rows, cols, src);
   switch(op) {
-  case OP_COVARIANCE:
+  case OP_DETERMINANT:
+    dst[0] = getDet (mtx);
+    break;
+  case OP_LOGDET:
     {
-      if (A_rank != 1 || B_rank != 1) {
-	MORE_ERROR () << "Both arguments must be vectors.";
-	RANK_ERROR;
-	break;
-      }
-      if (A_count != B_count) {
-	MORE_ERROR () << "Arguments must be of the same length.";
-	LENGTH_ERROR;
-	break;
-      }
-
-      vector<double> Areals (A_count);
-      vector<double> Aimags (A_count);
-      vector<double> Breals (B_count);
-      vector<double> Bimags (B_count);
-      loop (c, A_count) {
-	const Cell & Av = A->get_cravel (c);
-	const Cell & Bv = B->get_cravel (c);
-	Areals[c] = Av.get_real_value ();
-	Aimags[c] = Av.is_complex_cell () ? Av.get_imag_value () : 0.0;
-	Breals[c] = Bv.get_real_value ();
-	Bimags[c] = Bv.is_complex_cell () ? Bv.get_imag_value () : 0.0;
-      }
-      double realcov =
-	gsl_stats_covariance (Areals.data (), 1, Breals.data (), 1, A_count);
-      double imagcov =
-	gsl_stats_covariance (Aimags.data (), 1, Bimags.data (), 1, A_count);
-      rc = (imagcov == 0.0) ?
-	FloatScalar (realcov, LOC) :
-	ComplexScalar (realcov, imagcov, LOC);
+      complex<double> phase;
+      double lndet;
+      getLogDet (mtx, phase, lndet);
+      dst[0] = phase;
+      dst[1] = complex<double> (lndet, 0.0);
     }
     break;
-  case OP_HOMOGENEOUS_MATRIX:
+  case OP_EIGENVALUES:
     {
-      if (A_count == 3 && B_count == 3) 
-	rc = genRotation (16, A, B);
-      else {
-	MORE_ERROR () << "Both arguments must be vectors of ⍴ = 3.";
-	RANK_ERROR;
-      }
+      vector<complex<double>> vals = getEigenvalues (mtx);
+      loop (j, rows) dst[j] = vals[j];
     }
     break;
-  case OP_CROSS_PRODUCT:
-    if (A_rank == 1 && B_rank == 1 && A_count == B_count && A_count == 3) {
-      Matrix *mtx = new Matrix (3, 3);
-      loop (c, 3) {
-	const Cell & Av = A->get_cravel (c);
-	const Cell & Bv = B->get_cravel (c);
-	APL_Float Avr = Av.get_real_value ();
-	APL_Float Avi = Av.is_complex_cell () ? Av.get_imag_value () : 0.0;
-	APL_Float Bvr = Bv.get_real_value ();
-	APL_Float Bvi = Bv.is_complex_cell () ? Bv.get_imag_value () : 0.0;
-	mtx->val (0, c, complex (1.0, 0.0));
-	mtx->val (1, c, complex (Avr, Avi));
-	mtx->val (2, c, complex (Bvr, Bvi));
-      }
-      {
-	vector<complex<double>> cp = getCross (mtx);
-	Shape shape_Z;
-	shape_Z.add_shape_item(mtx->cols ());
-	rc = Value_P (shape_Z, LOC);
-	bool is_cpx = false;
-	for (int i = 0; i < mtx->cols (); i++) {
-	  if (cp[i].imag () != 0.0) {
-	    is_cpx = true;
-	    break;
-	  }
-	}
-	for (int i = 0; i < mtx->cols (); i++) {
-	  if (is_cpx) 
-	    (*rc).set_ravel_Complex (i, cp[i].real (), cp[i].imag ());
-	  else
-	    (*rc).set_ravel_Float (i, cp[i].real ());
-	}
-	rc->check_value(LOC);
+  case OP_EIGENVECTORS:
+  case OP_EIGENSYSTEM:
+    {
+      vector<complex<double>> vals (rows);
+      CMatrix vecs (rows, rows);
+      getEigensystem (mtx, vals, &vecs);
+      if (op == OP_EIGENSYSTEM) {
+	loop (j, rows) dst[j] = vals[j];
+	dst += rows;
       }
-    }
-    else {
-      MORE_ERROR () << "Invalid rank..";
-      RANK_ERROR;
+      memcpy (dst, vecs.data (), in_size * sizeof(complex<double>));
     }
     break;
-  case OP_VECTOR_ANGLE:
-    if (A_rank == 1 && B_rank == 1 && A_count == B_count) {
-      vector<complex<double>> Av (A_count);
-      vector<complex<double>> Bv (B_count);
-      loop (c, A_count) {
-	const Cell & Ac = A->get_cravel (c);
-	const Cell & Bc = B->get_cravel (c);
-	APL_Float Avr = Ac.get_real_value ();
-	APL_Float Avi = Ac.is_complex_cell () ? Ac.get_imag_value () : 0.0;
-	APL_Float Bvr = Bc.get_real_value ();
-	APL_Float Bvi = Bc.is_complex_cell () ? Bc.get_imag_value () : 0.0;
-	Av[c] = complex<double> (Avr, Avi);
-	Bv[c] = complex<double> (Bvr, Bvi);
-      }
-      complex<double> Amag = magnitude (Av);
-      complex<double> Bmag = magnitude (Bv);
-      complex<double> mag = Amag * Bmag;
-      if (mag != complex<double>(0.0, 0.0)) {
-	complex<double> dp (0.0, 0.0);
-	loop (i, Av.size ()) dp += Av[i] * Bv[i];
-	complex<double> an = acos (dp/mag);
-	rc = ComplexScalar((APL_Float)an.real (), an.imag (), LOC);
-      }
-      else {
-	MORE_ERROR () << "Invalid vector(s).";
-	DOMAIN_ERROR;
-      }
+  case OP_INVERSE:
+    {
+      LUFactor lu (mtx);
+      if (lu.is_ill_conditioned ()) return false;
+      Matrix<T> *inv = lu.inverse<T> ();
+      loop (i, in_size) dst[i] = inv->data ()[i];
     }
     break;
-  default:
-    MORE_ERROR () << "Not a dyadic operation.";
-    DOMAIN_ERROR;
-    break;
   }
-  
-
-  return Token(TOK_APL_VALUE1, rc);
+  return true;
 }
 
-static Token
-eval_AB(Value_P A, Value_P B, const NativeFunction * caller)
-{
-  Value_P X = IntScalar (OP_DETERMINANT, LOC);	// default to determinant
-  return eval_AXB (A, X, B, caller);
-}
+/***
+    The ops on a rank > 2 argument, which is taken as a stack of matrices
+    along its leading axes.  The ravel is read once here, the slices are
+    shared out over the thread pool, each writing its own part of a flat
+    result buffer, and the result is built here again, since only the
+    interpreter's thread may touch APL values.  The result has the leading
+    shape of B followed by the shape of the per-matrix result.
+ ***/
 
-void *
-get_function_mux(const char * function_name)
+static Value_P
+genBatch (int op, Value_P B, const CellType celltype)
 {
-  if (!gslcblas_lib)
-    gslcblas_lib = dlopen ("libgslcblas.so", RTLD_NOW | RTLD_GLOBAL);
+  const ShapeItem count = B->element_count ();
+  const auto      rank  = B->get_rank ();
+  ShapeItem rows = B->get_shape_item (rank - 2);
+  ShapeItem cols = B->get_shape_item (rank - 1);
+  ShapeItem slices = 1;
+  loop (a, rank - 2) slices *= B->get_shape_item (a);
+
+  if (B->is_empty ()) {
+    MORE_ERROR () << "Null argument.";
+    LENGTH_ERROR;	
+  }
+  if (op != OP_NORM && rows != cols) {
+    MORE_ERROR () << "Not a square matrix.";
+    RANK_ERROR;
+  }
 
-  if (!gsl_lib)
-    gsl_lib = dlopen ("libgsl.so", RTLD_LAZY | RTLD_GLOBAL);
+  Shape shape_W;
+  loop (a, rank - 2) shape_W.add_shape_item (B->get_shape_item (a));
+  switch(op) {
+  case OP_DETERMINANT:
+    break;
+  case OP_LOGDET:
+    shape_W.add_shape_item (2);
+    break;
+  case OP_EIGENVALUES:
+    shape_W.add_shape_item (rows);
+    break;
+  case OP_EIGENSYSTEM:
+    shape_W.add_shape_item (rows + 1);
+    shape_W.add_shape_item (cols);
+    break;
+  case OP_EIGENVECTORS:
+  case OP_INVERSE:
+  case OP_NORM:
+    shape_W.add_shape_item (rows);
+    shape_W.add_shape_item (cols);
+    break;
+  default:
+    MORE_ERROR () <<
+      "Only determinant, logdet, eigen, norm, and inverse can take "
+      "an argument of rank greater than 2";
+    RANK_ERROR;
+    break;
+  }
+  const ShapeItem in_size  = rows * cols;
+  const ShapeItem out_size = shape_W.get_volume () / slices;
+
+  bool cpx   = (celltype & CT_COMPLEX);
+  bool exact = (op == OP_DETERMINANT && !(celltype & (CT_FLOAT | CT_COMPLEX)));
+  complex<double> *cin = cpx ? arenaArray<complex<double>> (count) : nullptr;
+  double          *rin = cpx ? nullptr : arenaArray<double> (count);
+  int64_t         *iin = exact ? arenaArray<int64_t> (count) : nullptr;
+  if (cpx) RavelView<complex<double>> (B, 0, 1, count).copy (cin);
+  else     RavelView<double> (B, 0, 1, count).copy (rin);
+  if (iin) loop (i, count) iin[i] = B->get_cravel (i).get_int_value ();
+
+  if (cpx && (op == OP_EIGENVALUES || op == OP_EIGENVECTORS ||
+	      op == OP_EIGENSYSTEM)) {
+    loop (s, slices) {
+      CMatrix slice (rows, cols, cin + s * in_size);
+      checkEigenArg (&slice, s);
+    }
+  }
+
+  complex<double> *out = arenaArray<complex<double>> (slices * out_size);
+  int64_t *idets = arenaArray<int64_t> (slices);
+  char *is_int   = arenaArray<char> (slices);	// det came out exact
+  char *singular = arenaArray<char> (slices);
+
+  parallelFor (slices, [&] (size_t s) {
+    complex<double> *dst = out + s * out_size;
+    is_int[s] = singular[s] = 0;
+
+    if (iin) {
+      int64_t idet;
+      if (getIntDet (iin + s * in_size, rows, idet)) {
+	idets[s]  = idet;
+	is_int[s] = 1;
+	return;
+      }
+    }
+    bool ok = cpx ?
+      batchSlice (op, cin + s * in_size, rows, cols, dst) :
+      batchSlice (op, rin + s * in_size, rows, cols, dst);
+    singular[s] = !ok;
+  });
+
+  loop (s, slices) {
+    if (singular[s]) {
+      MORE_ERROR () << "Singular matrix at slice " << s << ".";
+      DOMAIN_ERROR;
+    }
+  }
+
+  const ShapeItem out_count = slices * out_size;
+  ResultBuilder rb (shape_W);
+  if (op != OP_DETERMINANT && op != OP_LOGDET) rb.put (out);
+  else {
+    loop (i, out_count) {
+      if (op == OP_DETERMINANT && is_int[i])
+	rb.set (i, (APL_Integer)idets[i]);
+      else if (out[i].imag () == 0.0)
+	rb.set (i, out[i].real ());
+      else
+	rb.set (i, out[i]);
+    }
+  }
+  return rb.get ();
+}
+
+/***
+    The determinant of B exactly, by Bareiss elimination, if B is a square
+    matrix of integers.  Returns false if it isn't, or if the elimination
+    would overflow, for the caller to fall back to the LU.
+ ***/
+
+static bool
+exactDet (Value_P B, const CellType celltype, int64_t &det)
+{
+  if (B->get_rank () != 2 || (celltype & (CT_FLOAT | CT_COMPLEX)))
+    return false;
+  const ShapeItem dim = B->get_shape_item (0);
+  if (B->get_shape_item (1) != dim) return false;
+  int64_t *imtx = arenaArray<int64_t> (dim * dim);
+  loop (i, dim * dim) imtx[i] = B->get_cravel (i).get_int_value ();
+  return getIntDet (imtx, dim, det);
+}
+
+/***
+    The ops on a single square matrix, as Matrix<double> when B has no
+    complex cells.
+ ***/
+
+template<typename T> static Value_P
+genSquare (int op, Value_P B, const CellType celltype)
+{
+  const ShapeItem rows = B->get_shape_item(0);
+  const ShapeItem cols = B->get_shape_item(1);
+  Value_P rc = Str0(LOC);
+
+  int64_t idet;
+  if (op == OP_DETERMINANT && exactDet (B, celltype, idet))
+    return IntScalar (idet, LOC);
+
+  Matrix<T> *mtx = RavelView<T> (B, 0, rows, cols).matrix ();
+
+  switch(op) {
+  case OP_EIGENVECTORS:
+  case OP_EIGENSYSTEM:
+    {
+      int dim = mtx->rows ();
+      checkEigenArg (mtx);
+      vector<complex<double>> vals (dim);
+      CMatrix vecs (dim, dim);
+      getEigensystem (mtx, vals, &vecs);
+      rc = genEigens (op, vals, &vecs);
+    }
+    break;
+  case OP_EIGENVALUES:
+    {
+      checkEigenArg (mtx);
+      vector<complex<double>> vals = getEigenvalues (mtx);
+      rc = genEigens (op, vals, nullptr);
+    }
+    break;
+  case OP_DETERMINANT:
+    {
+      rc = ResultBuilder::scalar (getDet (mtx));
+    }
+    break;
+  case OP_LOGDET:
+    rc = genLogDet (mtx);
+    break;
+  case OP_INVERSE:
+    {
+      LUFactor lu (mtx);
+      if (lu.is_ill_conditioned ()) {
+	delete mtx;
+	MORE_ERROR () << "Singular matrix.";
+	DOMAIN_ERROR;
+      }
+      Matrix<T> *inv = lu.inverse<T> ();
+      rc = genMatrix (inv);
+      delete inv;
+    }
+    break;
+  }
+
+  delete mtx;
+  return rc;
+}
+
+/***
+    An intermediate result in a pipeline, held as a Matrix (a scalar as
+    1 × 1 and a vector as 1 × n) of whichever type it needs.
+ ***/
+
+struct Stage
+{
+  int      rank;
+  RMatrix *rm;		// exactly one of rm and cm is set
+  CMatrix *cm;
+};
+
+static Stage
+toStage (CMatrix *m, int rank)
+{
+  if (!m->is_real ())
+    return Stage { rank, nullptr, m };
+  RMatrix *rm = new RMatrix (m->rows (), m->cols ());
+  loop (i, m->rows () * m->cols ()) rm->data ()[i] = m->data ()[i].real ();
+  return Stage { rank, rm, nullptr };
+}
+
+static Stage
+toStage (RMatrix *m, int rank)
+{
+  return Stage { rank, m, nullptr };
+}
+
+template<typename T> static Stage
+runStage (int op, Matrix<T> *in, int rank)
+{
+  const int rows = in->rows ();
+  const int cols = in->cols ();
+
+  if (op == OP_NORM) {
+    normalise (in->data (), rows * cols, in->data ());
+    return toStage (in, rank);
+  }
+  if (op == OP_COVARIANCE) {
+    if (rank != 2) {
+      MORE_ERROR () << "Covariance needs a matrix.";
+      RANK_ERROR;
+    }
+    if (cols < 2) {
+      MORE_ERROR () << "Covariance needs at least two samples.";
+      LENGTH_ERROR;
+    }
+    return toStage (getCovariance (in), 2);
+  }
+  
+  if (rank != 2 || rows != cols) {
+    MORE_ERROR () << "Not a square matrix.";
+    RANK_ERROR;
+  }
+  switch(op) {
+  case OP_DETERMINANT:
+    {
+      CMatrix *det = new CMatrix (1, 1);
+      det->val (0, 0, getDet (in));
+      return toStage (det, 0);
+    }
+  case OP_LOGDET:
+    {
+      complex<double> phase;
+      double lndet;
+      getLogDet (in, phase, lndet);
+      CMatrix *ld = new CMatrix (1, 2);
+      ld->val (0, 0, phase);
+      ld->val (0, 1, lndet);
+      return toStage (ld, 1);
+    }
+  case OP_INVERSE:
+    {
+      LUFactor lu (in);
+      if (lu.is_ill_conditioned ()) {
+	MORE_ERROR () << "Singular matrix.";
+	DOMAIN_ERROR;
+      }
+      return toStage (lu.inverse<T> (), 2);
+    }
+  case OP_EIGENVALUES:
+    {
+      checkEigenArg (in);
+      vector<complex<double>> vals = getEigenvalues (in);
+      CMatrix *ev = new CMatrix (1, rows);
+      loop (j, rows) ev->val (0, j, vals[j]);
+      return toStage (ev, 1);
+    }
+  case OP_EIGENVECTORS:
+  case OP_EIGENSYSTEM:
+    {
+      checkEigenArg (in);
+      vector<complex<double>> vals (rows);
+      CMatrix vecs (rows, rows);
+      getEigensystem (in, vals, &vecs);
+      int vrows = (op == OP_EIGENSYSTEM) ? 1 : 0;
+      CMatrix *es = new CMatrix (vrows + rows, rows);
+      if (vrows) loop (j, rows) es->val (0, j, vals[j]);
+      memcpy (es->row (vrows), vecs.data (),
+	      rows * rows * sizeof(complex<double>));
+      return toStage (es, 2);
+    }
+  }
+  MORE_ERROR () << "That op can't be part of a pipeline.";
+  DOMAIN_ERROR;
+}
+
+template<typename T> static Value_P
+genStageValue (Matrix<T> *m, int rank)
+{
+  Shape shape_W;
+  if (rank == 2) shape_W.add_shape_item (m->rows ());
+  if (rank >= 1) shape_W.add_shape_item (m->cols ());
+  ResultBuilder rb (shape_W);
+  rb.put (m->data ());
+  return rb.get ();
+}
+
+/***
+    Solves B x = A, where A has nrhs columns, as Matrix<double> when
+    neither argument has complex cells.
+ ***/
+
+template<typename T> static Value_P
+genSolve (Value_P A, Value_P B, int dim, int nrhs)
+{
+  Matrix<T> *mtx = RavelView<T> (B, 0, dim, dim).matrix ();
+  LUFactor lu (mtx);
+  if (lu.is_ill_conditioned ()) {
+    MORE_ERROR () << "Singular matrix.";
+    DOMAIN_ERROR;
+  }
+      
+  Matrix<T> *rhs = RavelView<T> (A, 0, dim, nrhs).matrix ();
+  lu.solve (rhs);
+  Value_P rc = genMatrix (rhs);
+  delete rhs;
+  return rc;
+}
+
+static
+complex<double>
+magnitude (vector<complex<double>> &v)
+{
+  complex<double> rc (0.0, 0.0);
+  loop (i, v.size ()) rc += v[i] * v[i];
+  rc = sqrt (rc);
+  return rc;
+}
+
+/***
+    The kernels the op registry dispatches to.  Each is given its op,
+    since one kernel may serve several, and the cell types of its
+    arguments, with CT_COMPLEX already set for ops that have no real
+    path.  The registry has checked the rank of B and, unless the op takes
+    text, that the arguments are numeric.
+ ***/
+
+static Value_P
+monSquare (int op, Value_P B, const CellType celltype)
+{
+  const auto rank = B->get_rank ();
+  if (rank > 2)
+    return genBatch (op, B, celltype);
+  
+  if (rank == 1) {	// only count == 1 vectors will work for det
+    if (B->element_count () != 1) {
+      MORE_ERROR () << "Vector argument.  No determinant posible.";
+      LENGTH_ERROR;
+    }
+    if (op == OP_DETERMINANT)
+      return ResultBuilder::scalar
+	(RavelView<complex<double>> (B, 0, 1, 1).val (0, 0));
+    CMatrix *mtx = RavelView<complex<double>> (B, 0, 1, 1).matrix ();
+    Value_P rc = genLogDet (mtx);
+    delete mtx;
+    return rc;
+  }
+
+  if (B->get_shape_item (0) != B->get_shape_item (1)) {
+    MORE_ERROR () << "Not a square matrix.";
+    RANK_ERROR;
+  }
+  return (celltype & CT_COMPLEX) ?
+    genSquare<complex<double>> (op, B, celltype) :
+    genSquare<double> (op, B, celltype);
+}
+
+static Value_P
+monCross (int op, Value_P B, const CellType celltype)
+{
+  ShapeItem rows = B->get_shape_item(0);
+  ShapeItem cols = B->get_shape_item(1);
+  if (rows + 1 != cols) {
+    MORE_ERROR () << 
+      "For cross product, the shape of the argument must be [n-1 n]";
+    RANK_ERROR;
+  }
+  return (celltype & CT_COMPLEX) ?
+    genCross<complex<double>> (B, cols) : genCross<double> (B, cols);
+}
+
+static Value_P
+monCovariance (int op, Value_P B, const CellType celltype)
+{
+  ShapeItem rows = B->get_shape_item(0);
+  ShapeItem cols = B->get_shape_item(1);
+  if (cols < 2) {
+    MORE_ERROR () << "Covariance needs at least two samples.";
+    LENGTH_ERROR;
+  }
+  if (celltype & CT_COMPLEX)
+    return genMatrix (getCovariance
+		      (RavelView<complex<double>> (B, 0, rows, cols).matrix ()));
+  else
+    return genMatrix (getCovariance
+		      (RavelView<double> (B, 0, rows, cols).matrix ()));
+}
+
+static Value_P
+monNorm (int op, Value_P B, const CellType celltype)
+{
+  if (B->get_rank () > 2)
+    return genBatch (op, B, celltype);
+  return (celltype & CT_COMPLEX) ?
+    genNorm<complex<double>> (B) : genNorm<double> (B);
+}
+
+static Value_P
+monGaussian (int op, Value_P B, const CellType celltype)
+{
+  if (B->get_rank () > 0)
+    return genRands (B);
+  
+  const Cell & Bv = B->get_cravel (0);
+  APL_Float xvr = Bv.get_real_value ();
+  APL_Float xvi = Bv.is_complex_cell ()
+    ? Bv.get_imag_value () : 0.0;
+  complex<double> val = genRand (xvr, xvi);
+  return (xvi == 0.0) ?
+    FloatScalar (val.real (), LOC) :
+    ComplexScalar (val.real (), val.imag (), LOC);
+}
+
+static Value_P
+monRotate (int op, Value_P B, const CellType celltype)
+{
+  if (B->get_rank () == 1) {
+    if (B->element_count () != 3) {
+      MORE_ERROR () << "Argument must be a vector of length 3";
+      RANK_ERROR;
+    }
+    return genRotation (9, nullptr, B);
+  }
+  
+  const Cell & Bv = B->get_cravel (0);
+  APL_Float xvr = Bv.get_real_value ();
+  APL_Float xvi = Bv.is_complex_cell ()
+    ? Bv.get_imag_value () : 0.0;
+  complex<double>theta (xvr, xvi);
+  complex<double>cosx = cos (theta);
+  complex<double>sinx = sin (theta);
+  complex<double> z[4] = { cosx, -sinx, sinx, cosx };
+  Shape shape_W;
+  shape_W.add_shape_item (2);
+  shape_W.add_shape_item (2);
+  ResultBuilder rb (shape_W);
+  rb.put (z);
+  return rb.get ();
+}
+
+static Value_P
+monIdent (int op, Value_P B, const CellType celltype)
+{
+  int dim = B->get_sole_integer();
+  Shape shape_W;
+  shape_W.add_shape_item (dim);
+  shape_W.add_shape_item (dim);
+  ResultBuilder rb (shape_W);
+
+  int p = 0;
+  for (int i = 0; i < dim; i++) {
+    for (int j = 0; j < dim; j++, p++) 
+      rb.set (p, (APL_Integer)((i == j) ? 1 : 0));
+  }
+  return rb.get ();
+}
+
+static Value_P
+monArena (int op, Value_P B, const CellType celltype)
+{
+  APL_Integer cap = B->get_sole_integer ();
+  Value_P rc = IntScalar (Arena::get_cap (), LOC);
+  if (cap >= 0) Arena::set_cap (cap);
+  return rc;
+}
+
+static Value_P
+monThreads (int op, Value_P B, const CellType celltype)
+{
+  APL_Integer threads = B->get_sole_integer ();
+  Value_P rc = IntScalar (getPoolSize (), LOC);
+  if (threads >= 0) setPoolSize (threads);
+  return rc;
+}
+
+static Value_P
+monSeed (int op, Value_P B, const CellType celltype)
+{
+  APL_Integer seed = B->get_sole_integer ();
+  Value_P rc = IntScalar ((APL_Integer)getSeed (), LOC);
+  if (seed >= 0) setSeed (seed);
+  return rc;
+}
+
+/***
+    The streaming covariance accumulators.  acc_open d gives the handle
+    of a new accumulator for d variables, h acc_add M feeds it the d × n
+    matrix M, or a single sample as a vector of length d, h acc_merge g
+    folds accumulator g into h, acc_cov h and acc_corr h give the
+    covariance and correlation matrices of everything seen so far, and
+    acc_close h frees it.  acc_add, acc_merge, and acc_close return the
+    number of samples the accumulator had seen.
+ ***/
+
+static CovAccumulator *
+getAccumulator (Value_P H)
+{
+  CovAccumulator *acc =
+    H->is_numeric_scalar () ? accGet (H->get_sole_integer ()) : nullptr;
+  if (!acc) {
+    MORE_ERROR () << "Invalid accumulator handle.";
+    DOMAIN_ERROR;
+  }
+  return acc;
+}
+
+static Value_P
+monAccOpen (int op, Value_P B, const CellType celltype)
+{
+  APL_Integer dim = B->get_sole_integer ();
+  if (dim < 1) {
+    MORE_ERROR () << "Number of variables must be positive.";
+    DOMAIN_ERROR;
+  }
+  return IntScalar (accOpen (dim), LOC);
+}
+
+static Value_P
+monAccResult (int op, Value_P B, const CellType celltype)
+{
+  CovAccumulator *acc = getAccumulator (B);
+  if (acc->count () < 2.0) {
+    MORE_ERROR () << "Covariance needs at least two samples.";
+    LENGTH_ERROR;
+  }
+  CMatrix *res = new CMatrix (acc->dim (), acc->dim ());
+  if (op == OP_ACC_COV)
+    acc->covariance (res);
+  else if (!acc->correlation (res)) {
+    MORE_ERROR () << "A variable has zero variance.";
+    DOMAIN_ERROR;
+  }
+  return genMatrix (res);
+}
+
+static Value_P
+monAccClose (int op, Value_P B, const CellType celltype)
+{
+  APL_Integer count = (APL_Integer)getAccumulator (B)->count ();
+  accFree (B->get_sole_integer ());
+  return IntScalar (count, LOC);
+}
+
+static Value_P
+dyaAccAdd (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  CovAccumulator *acc = getAccumulator (A);
+  const int dim = acc->dim ();
+  const int cols = (B->get_rank () == 2) ? B->get_shape_item (1) : 1;
+  if (B->get_shape_item (0) != dim) {
+    MORE_ERROR () << "Accumulator is for " << dim << " variables.";
+    LENGTH_ERROR;
+  }
+  if (celltype & CT_COMPLEX) {
+    complex<double> *x = arenaArray<complex<double>> (dim * cols);
+    RavelView<complex<double>> (B, 0, dim, cols).copy (x);
+    acc->add (x, cols);
+  }
+  else {
+    double *x = arenaArray<double> (dim * cols);
+    RavelView<double> (B, 0, dim, cols).copy (x);
+    acc->add (x, cols);
+  }
+  return IntScalar ((APL_Integer)acc->count (), LOC);
+}
+
+static Value_P
+dyaAccMerge (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  CovAccumulator *acc   = getAccumulator (A);
+  CovAccumulator *other = getAccumulator (B);
+  if (acc == other) {
+    MORE_ERROR () << "An accumulator can't be merged into itself.";
+    DOMAIN_ERROR;
+  }
+  if (acc->dim () != other->dim ()) {
+    MORE_ERROR () << "Accumulators are for different numbers of variables.";
+    LENGTH_ERROR;
+  }
+  acc->merge (*other);
+  return IntScalar ((APL_Integer)acc->count (), LOC);
+}
+
+/***
+    w rolling_cov S, the covariance matrices of the d × T series S over a
+    window of w samples sliding along it, as a (T-w+1) × d × d array;
+    with w 1 as the left argument, just the final d × d one.
+ ***/
+
+static Value_P
+dyaRollingCov (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  const ShapeItem A_count = A->element_count ();
+  if (A->get_rank () > 1 || A_count < 1 || A_count > 2) {
+    MORE_ERROR () << "Left argument must be the window length, "
+      "optionally followed by 1 for the final window only.";
+    RANK_ERROR;
+  }
+  const int dim = B->get_shape_item (0);
+  const int len = B->get_shape_item (1);
+  const APL_Integer w = A->get_cravel (0).get_int_value ();
+  const bool last = (A_count == 2) && A->get_cravel (1).get_int_value ();
+  if (w < 2 || w > len) {
+    MORE_ERROR () << "Window length must be between 2 and " << len;
+    DOMAIN_ERROR;
+  }
+
+  Shape shape_W;
+  if (!last) shape_W.add_shape_item (len - w + 1);
+  shape_W.add_shape_item (dim);
+  shape_W.add_shape_item (dim);
+  ResultBuilder rb (shape_W);
+  if (celltype & CT_COMPLEX) {
+    complex<double> *x = arenaArray<complex<double>> (dim * len);
+    complex<double> *z = arenaArray<complex<double>> (shape_W.get_volume ());
+    RavelView<complex<double>> (B, 0, dim, len).copy (x);
+    rollingCovariance (x, dim, len, w, last, z);
+    rb.put (z);
+  }
+  else {
+    double *x = arenaArray<double> (dim * len);
+    double *z = arenaArray<double> (shape_W.get_volume ());
+    RavelView<double> (B, 0, dim, len).copy (x);
+    rollingCovariance (x, dim, len, w, last, z);
+    rb.put (z);
+  }
+  return rb.get ();
+}
+
+/***
+    Principal component analysis of the d × n data B, one row per
+    variable as for covm:  a nested vector of the variances along the k
+    leading components, the components as the rows of a k × d matrix,
+    and, if scores is set, the k × n projections of the centred data on
+    them.  The data is centred and its covariance formed in one pass by
+    getCoMoments (), the components found by the symmetric eigensolver
+    (Lanczos when k is small against d), and the scores by one multiply
+    against the data already centred, all without a trip back to APL.
+ ***/
+
+template<typename T> static Value_P
+genPca (Value_P B, int k, bool scores)
+{
+  const int dim = B->get_shape_item (0);
+  const int n   = B->get_shape_item (1);
+  if (n < 2) {
+    MORE_ERROR () << "Covariance needs at least two samples.";
+    LENGTH_ERROR;
+  }
+  if (k < 1 || k > dim) {
+    MORE_ERROR () << "Number of components must be between 1 and " << dim;
+    DOMAIN_ERROR;
+  }
+
+  T *x   = arenaArray<T> (dim * n);
+  T *cov = arenaArray<T> (dim * dim);
+  RavelView<T> (B, 0, dim, n).copy (x);
+  getCoMoments (x, dim, n, 1.0 / (n - 1), (T *)nullptr, cov);
+
+  Matrix<T> covm (dim, dim, cov);
+  vector<complex<double>> vals (k);
+  CMatrix vecs (k, dim);
+  getTopEigensystem (&covm, k, vals, &vecs);
+
+  Shape shape_V;
+  shape_V.add_shape_item (k);
+  ResultBuilder vb (shape_V);
+  vb.put (vals.data ());
+  
+  Shape shape_C;
+  shape_C.add_shape_item (k);
+  shape_C.add_shape_item (dim);
+  ResultBuilder cb (shape_C);
+  cb.put (vecs.data ());
+
+  Shape shape_W;
+  shape_W.add_shape_item (scores ? 3 : 2);
+  ResultBuilder rb (shape_W);
+  rb.set (0, vb.get ());
+  rb.set (1, cb.get ());
+  if (scores) {
+    T *s = arenaArray<T> (k * n);
+    project (&vecs, x, n, s);
+    Shape shape_S;
+    shape_S.add_shape_item (k);
+    shape_S.add_shape_item (n);
+    ResultBuilder sb (shape_S);
+    sb.put (s);
+    rb.set (2, sb.get ());
+  }
+  return rb.get ();
+}
+
+static Value_P
+monPca (int op, Value_P B, const CellType celltype)
+{
+  const int dim = B->get_shape_item (0);
+  return (celltype & CT_COMPLEX) ?
+    genPca<complex<double>> (B, dim, false) : genPca<double> (B, dim, false);
+}
+
+static Value_P
+dyaPca (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  const ShapeItem A_count = A->element_count ();
+  if (A->get_rank () > 1 || A_count < 1 || A_count > 2) {
+    MORE_ERROR () << "Left argument must be the number of components, "
+      "optionally followed by 1 for the scores.";
+    RANK_ERROR;
+  }
+  const APL_Integer k = A->get_cravel (0).get_int_value ();
+  const bool scores = (A_count == 2) && A->get_cravel (1).get_int_value ();
+  return (celltype & CT_COMPLEX) ?
+    genPca<complex<double>> (B, k, scores) : genPca<double> (B, k, scores);
+}
+
+/***
+    k svd m, or k q svd m with q power iterations rather than two, for the
+    k largest singular values of the real m and their singular vectors:  a
+    nested vector of the values, the left vectors as the rows of a k × rows
+    matrix, and the right as the rows of a k × cols one.  Done by the
+    randomised range finder, so it's meant for big m and small k, and the
+    result is as good as the gap after the kth value makes it -- more
+    power iterations sharpen a slowly decaying spectrum.  GSL has no
+    complex SVD, so neither does this.
+ ***/
+
+static Value_P
+dyaSvd (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  const ShapeItem A_count = A->element_count ();
+  if (A->get_rank () > 1 || A_count < 1 || A_count > 2) {
+    MORE_ERROR () << "Left argument must be the number of singular values, "
+      "optionally followed by the number of power iterations.";
+    RANK_ERROR;
+  }
+  if (celltype & CT_COMPLEX) {
+    MORE_ERROR () << "SVD is only available for real matrices.";
+    DOMAIN_ERROR;
+  }
+  const int rows = B->get_shape_item (0);
+  const int cols = B->get_shape_item (1);
+  const APL_Integer k = A->get_cravel (0).get_int_value ();
+  const APL_Integer q = (A_count == 2) ? A->get_cravel (1).get_int_value () : 2;
+  if (k < 1 || k > min (rows, cols)) {
+    MORE_ERROR () << "Number of singular values must be between 1 and "
+		  << min (rows, cols);
+    DOMAIN_ERROR;
+  }
+  if (q < 0) {
+    MORE_ERROR () << "Number of power iterations can't be negative.";
+    DOMAIN_ERROR;
+  }
+
+  double *a = arenaArray<double> (rows * cols);
+  double *s = arenaArray<double> (k);
+  double *u = arenaArray<double> (k * rows);
+  double *v = arenaArray<double> (k * cols);
+  RavelView<double> (B, 0, rows, cols).copy (a);
+  randomSvd (a, rows, cols, k, q, s, u, v);
+
+  Shape shape_S;
+  shape_S.add_shape_item (k);
+  ResultBuilder sb (shape_S);
+  sb.put (s);
+
+  Shape shape_U;
+  shape_U.add_shape_item (k);
+  shape_U.add_shape_item (rows);
+  ResultBuilder ub (shape_U);
+  ub.put (u);
+
+  Shape shape_V;
+  shape_V.add_shape_item (k);
+  shape_V.add_shape_item (cols);
+  ResultBuilder vb (shape_V);
+  vb.put (v);
+
+  Shape shape_Z;
+  shape_Z.add_shape_item (3);
+  ResultBuilder rb (shape_Z);
+  rb.set (0, sb.get ());
+  rb.set (1, ub.get ());
+  rb.set (2, vb.get ());
+  return rb.get ();
+}
+
+static Value_P
+dyaEigen (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  if (B->get_shape_item (0) != B->get_shape_item (1)) {
+    MORE_ERROR () << "Right argument must be a square matrix.";
+    RANK_ERROR;
+  }
+  if (!A->is_numeric_scalar ()) {
+    MORE_ERROR () << "Left argument must be the number of eigenpairs.";
+    RANK_ERROR;
+  }
+  int dim = B->get_shape_item (0);
+  APL_Integer k = A->get_sole_integer ();
+  if (k < 1 || k > dim) {
+    MORE_ERROR () << "Number of eigenpairs must be between 1 and " << dim;
+    DOMAIN_ERROR;
+  }
+      
+  vector<complex<double>> vals (k);
+  CMatrix vecs (k, dim);
+  if (B->deep_cell_types () & CT_COMPLEX) {
+    CMatrix *mtx = RavelView<complex<double>> (B, 0, dim, dim).matrix ();
+    checkEigenArg (mtx);
+    getTopEigensystem (mtx, k, vals, &vecs);
+  }
+  else
+    getTopEigensystem (RavelView<double> (B, 0, dim, dim).matrix (),
+		       k, vals, &vecs);
+  return genEigens (op, vals, &vecs);
+}
+
+/***
+    N samples from the multivariate normal with covariance A and mean 0,
+    as an N × d matrix.  A is factored once by Cholesky, and the pool then
+    fills blocks of rows with standard normals from one counter-based
+    stream, as genRands () does, and transforms each block in place with a
+    single triangular BLAS-3 multiply.  Blocks are an even number of rows
+    so that none starts in the middle of a Box-Muller pair.
+ ***/
+
+static Value_P
+dyaMvn (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  if (A->get_rank () != 2 ||
+      A->get_shape_item (0) != A->get_shape_item (1)) {
+    MORE_ERROR () << "Left argument must be a square matrix.";
+    RANK_ERROR;
+  }
+  if (A->deep_cell_types () & CT_COMPLEX) {
+    MORE_ERROR () << "Covariance matrix must be real.";
+    DOMAIN_ERROR;
+  }
+  const int dim = A->get_shape_item (0);
+  if (dim == 0) {
+    MORE_ERROR () << "Null argument.";
+    LENGTH_ERROR;	
+  }
+  const APL_Integer count = B->get_sole_integer ();
+  if (count < 0) {
+    MORE_ERROR () << "Number of samples must not be negative.";
+    DOMAIN_ERROR;
+  }
+
+  RMatrix *chol = RavelView<double> (A, 0, dim, dim).matrix ();
+  if (!getCholesky (chol)) {
+    delete chol;
+    MORE_ERROR () << "Covariance matrix is not positive definite.";
+    DOMAIN_ERROR;
+  }
+
+  size_t block = (RAND_CHUNK / dim) & ~1;
+  if (block < 2) block = 2;
+  const size_t blocks = (count + block - 1) / block;
+  const uint64_t stream = newStream ();
+  double *z = arenaArray<double> (count * dim);
+  parallelFor (blocks, [&] (size_t b) {
+    const size_t r0 = b * block;
+    const size_t rows = min (block, (size_t)count - r0);
+    fillNormals (z + r0 * dim, rows * dim, stream, r0 * dim);
+    correlate (chol, z + r0 * dim, rows);
+  });
+  delete chol;
+
+  Shape shape_W;
+  shape_W.add_shape_item (count);
+  shape_W.add_shape_item (dim);
+  ResultBuilder rb (shape_W);
+  rb.put (z);
+  return rb.get ();
+}
+
+/***
+    The covariance of two sample vectors, by the same centred product as
+    the monadic form, so that it's the off-diagonal element of covm on the
+    two stacked as rows:  the mean product of the deviations of A with the
+    conjugated deviations of B.
+ ***/
+
+template<typename T> static Value_P
+genCovariance (Value_P A, Value_P B, int n)
+{
+  T *x  = arenaArray<T> (2 * n);
+  T *m2 = arenaArray<T> (2 * 2);
+  RavelView<T> (A, 0, 1, n).copy (x);
+  RavelView<T> (B, 0, 1, n).copy (x + n);
+  getCoMoments (x, 2, n, 1.0 / (n - 1), (T *)nullptr, m2);
+  return ResultBuilder::scalar (complex<double> (m2[1]));
+}
+
+static Value_P
+dyaCovariance (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  const ShapeItem A_count = A->element_count();
+  if (A->get_rank () != 1) {
+    MORE_ERROR () << "Both arguments must be vectors.";
+    RANK_ERROR;
+  }
+  if (A_count != B->element_count ()) {
+    MORE_ERROR () << "Arguments must be of the same length.";
+    LENGTH_ERROR;
+  }
+
+  if (A_count < 2) {
+    MORE_ERROR () << "Covariance needs at least two samples.";
+    LENGTH_ERROR;
+  }
+  return (celltype & CT_COMPLEX) ?
+    genCovariance<complex<double>> (A, B, A_count) :
+    genCovariance<double> (A, B, A_count);
+}
+
+static Value_P
+dyaSolve (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  const auto A_rank = A->get_rank();
+  if (B->get_shape_item (0) != B->get_shape_item (1)) {
+    MORE_ERROR () << "Right argument must be a square matrix.";
+    RANK_ERROR;
+  }
+  if (A_rank < 1 || A_rank > 2) {
+    MORE_ERROR () << "Left argument must be a vector or matrix.";
+    RANK_ERROR;
+  }
+  int dim = B->get_shape_item (0);
+  if (A->get_shape_item (0) != dim) {
+    MORE_ERROR () << "Arguments must have the same number of rows.";
+    LENGTH_ERROR;
+  }
+  int nrhs = (A_rank == 2) ? A->get_shape_item (1) : 1;
+      
+  Value_P rc = (celltype & CT_COMPLEX) ?
+    genSolve<complex<double>> (A, B, dim, nrhs) :
+    genSolve<double> (A, B, dim, nrhs);
+  if (A_rank == 1) {
+    Shape shape_W;
+    shape_W.add_shape_item(dim);
+    (*rc).set_shape (shape_W);
+  }
+  return rc;
+}
+
+static Value_P
+dyaHomogeneous (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  if (A->element_count () != 3 || B->element_count () != 3) {
+    MORE_ERROR () << "Both arguments must be vectors of ⍴ = 3.";
+    RANK_ERROR;
+  }
+  return genRotation (16, A, B);
+}
+
+static Value_P
+dyaCross (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  if (A->get_rank () != 1 ||
+      A->element_count () != 3 || B->element_count () != 3) {
+    MORE_ERROR () << "Invalid rank..";
+    RANK_ERROR;
+  }
+  if (celltype & CT_COMPLEX) {
+    complex<double> vecs[6];
+    RavelView<complex<double>> (A, 0, 1, 3).copy (vecs);
+    RavelView<complex<double>> (B, 0, 1, 3).copy (vecs + 3);
+    return genCross (vecs, 3);
+  }
+  else {
+    double vecs[6];
+    RavelView<double> (A, 0, 1, 3).copy (vecs);
+    RavelView<double> (B, 0, 1, 3).copy (vecs + 3);
+    return genCross (vecs, 3);
+  }
+}
+
+static Value_P
+dyaAngle (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  const ShapeItem A_count = A->element_count();
+  if (A->get_rank () != 1 || A_count != B->element_count ()) {
+    MORE_ERROR () << "Invalid rank..";
+    RANK_ERROR;
+  }
+  vector<complex<double>> Av (A_count);
+  vector<complex<double>> Bv (A_count);
+  loop (c, A_count) {
+    const Cell & Ac = A->get_cravel (c);
+    const Cell & Bc = B->get_cravel (c);
+    APL_Float Avr = Ac.get_real_value ();
+    APL_Float Avi = Ac.is_complex_cell () ? Ac.get_imag_value () : 0.0;
+    APL_Float Bvr = Bc.get_real_value ();
+    APL_Float Bvi = Bc.is_complex_cell () ? Bc.get_imag_value () : 0.0;
+    Av[c] = complex<double> (Avr, Avi);
+    Bv[c] = complex<double> (Bvr, Bvi);
+  }
+  complex<double> Amag = magnitude (Av);
+  complex<double> Bmag = magnitude (Bv);
+  complex<double> mag = Amag * Bmag;
+  if (mag == complex<double>(0.0, 0.0)) {
+    MORE_ERROR () << "Invalid vector(s).";
+    DOMAIN_ERROR;
+  }
+  complex<double> dp (0.0, 0.0);
+  loop (i, Av.size ()) dp += Av[i] * Bv[i];
+  complex<double> an = acos (dp/mag);
+  return ResultBuilder::scalar (an);
+}
+
+static Value_P
+dyaPrint (int op, Value_P A, Value_P B, const CellType celltype)
+{
+  Value_P rc = Str0(LOC);
+  const CellType A_celltype = A->deep_cell_types();
+  
+  if (A->is_char_string () &&
+      B->is_char_string ()) {
+    const UCS_string ustr = B->get_UCS_ravel();
+    UTF8_string fn (ustr);
+    char *fns = (char *)(fn.c_str ());
+    bool append = false;
+    if (strlen (fns) > 1) {
+      if (*fns == '>') {
+	fns++;
+	append = true;
+      }
+    }
+    FILE *ofile = append ?
+      fopen (fns, "a") :
+      fopen (fns, "w");
+
+    const UCS_string vstr = A->get_UCS_ravel();
+    UTF8_string val (vstr);
+    char *vs = (char *)(val.c_str ());
+
+    fprintf (ofile, "%s\n", vs);
+    fclose (ofile);
+
+    return rc;
+  }
+  if ((A_celltype & CT_NUMERIC) &&
+      B->is_char_string ()) {
+    const ShapeItem A_count   = A->element_count();
+    const auto      A_rank    = A->get_rank();
+    const UCS_string  ustr = B->get_UCS_ravel();
+    UTF8_string fn (ustr);
+    char *fns = (char *)(fn.c_str ());
+    bool append = false;
+    if (strlen (fns) > 1) {
+      if (*fns == '>') {
+	fns++;
+	append = true;
+      }
+    }
+    FILE *ofile = append ?
+      fopen (fns, "a") :
+      fopen (fns, "w");
+
+    if (!ofile) {
+      MORE_ERROR () << "Open failure on " << ustr;
+      DOMAIN_ERROR;
+    }
+    if (A_rank <= 1) {
+      for (int i = 0; i < A_count; i++) {
+	const Cell & Av = A->get_cravel (i);
+	APL_Float Avr = Av.get_real_value ();
+	if (Av.is_complex_cell ()) {
+	  APL_Float Avi = Av.get_imag_value ();
+	  fprintf (ofile, "%gj%g ", Avr, Avi);
+	}
+	else
+	  fprintf (ofile, "%g ", Avr);
+      }
+      fprintf (ofile, "\n");
+    }
+    else {
+      int end_line = (int)(A->get_shape_item (A_rank-1));
+      int end_grid = end_line * (int)(A->get_shape_item (A_rank-2));
+      #define STR_LEN 256
+      char str[STR_LEN];
+      bool is_cpx = false;
+      int max_len = -1;
+      for (int i = 0; i < A_count; i++) {
+	int len;
+	const Cell & Av = A->get_cravel (i);
+	APL_Float Avr = Av.get_real_value ();
+	if (Av.is_complex_cell ()) {
+	  APL_Float Avi = Av.get_imag_value ();
+	  len = snprintf (str, STR_LEN, "%gj%g", Avr, Avi);
+	  if (Avi != 0.0) is_cpx = true;
+	}
+	else
+	  len = snprintf (str, STR_LEN, "%g", Avr);
+	if (max_len < len) max_len = len;
+      }
+      int *rho = arenaArray<int> (A_rank);
+      bzero (rho, A_rank * sizeof(int));
+      for (int i = 0; i < A_count; i++) {
+	if (A_rank > 2) {
+	  if (0 == i%end_grid) {
+	    fprintf (ofile, "\n[");
+	    for (int j = 0; j < A_rank - 2; j++)
+	      fprintf (ofile, "%d ", rho[j]);
+	    fprintf (ofile, "* *]:\n");
+	    bool carry = 1;
+	    for (int j = A_rank - 3; j >= 0; j--) {
+	      rho[j] += carry;
+	      if (rho[j] >= A->get_shape_item (j)) {
+		rho[j] = 0;
+		carry = 1;
+	      }
+	      else
+		carry = 0;
+	    }
+	  }
+	}
+	const Cell & Av = A->get_cravel (i);
+	APL_Float Avr = Av.get_real_value ();
+	char str[STR_LEN];
+	if (is_cpx && Av.is_complex_cell ()) {
+	  APL_Float Avi = Av.get_imag_value ();
+	  snprintf (str, STR_LEN, "%gj%g", Avr, Avi);
+	}
+	else
+	  snprintf (str, STR_LEN, "%g", Avr);
+	fprintf (ofile, "%*s ", max_len, str);
+	if (0 == (i+1)%end_line) fprintf (ofile, "\n");
+      }
+    }
+
+    fclose (ofile);
+    return rc;
+  }
+  else {
+    MORE_ERROR () << "Incompatible arguments.";
+    DOMAIN_ERROR;
+  }
+}
+
+/***
+    The op registry, indexed by op number.  Each entry gives the name the
+    op is known by, how many of its leading characters select it (0 if
+    the whole name must be given), its monadic and dyadic kernels, if it
+    has them, and the ranks of B each accepts.  Both mtx['name'] and
+    mtx[n], with n the op number, come here; the numeric form skips
+    decoding and matching the name, so it's the one to use in tight loops.
+    The help listing is generated from this too.
+ ***/
+
+typedef Value_P (*MonadicKernel) (int op, Value_P B,
+				  const CellType celltype);
+typedef Value_P (*DyadicKernel)  (int op, Value_P A, Value_P B,
+				  const CellType celltype);
+
+enum {			// ranks of B an op accepts
+  RK_SCALAR = 1,
+  RK_VECTOR = 2,
+  RK_MATRIX = 4,
+  RK_STACK  = 8,	// rank > 2, a stack of matrices
+  RK_ANY    = 15
+};
+
+enum {
+  OPF_REAL = 1,		// has a real path, taken if there are no complex cells
+  OPF_TEXT = 2,		// takes character arguments
+  OPF_CASE = 4,		// the selecting characters are case sensitive
+  OPF_STAGE = 8		// can be a pipeline stage
+};
+
+struct OpEntry {
+  const char    *name;
+  int            prefix;
+  MonadicKernel  monadic;
+  int            mranks;
+  DyadicKernel   dyadic;
+  int            dranks;
+  int            flags;
+};
+
+#define RK_SQUARE (RK_MATRIX | RK_STACK)
+#define RK_ARRAY  (RK_VECTOR | RK_MATRIX | RK_STACK)
+
+static const OpEntry opTable[] = {
+  { nullptr,         0, nullptr,       0,         nullptr,        0, 0 },
+  { "determinant",   1, monSquare,     RK_ARRAY,  nullptr,        0,
+    OPF_REAL | OPF_STAGE },
+  { "cross_product", 1, monCross,      RK_MATRIX, dyaCross,       RK_VECTOR,
+    OPF_REAL | OPF_CASE },
+  { "angle",         1, nullptr,       0,         dyaAngle,       RK_VECTOR,
+    0 },
+  { "eigenvector",   0, monSquare,     RK_SQUARE, dyaEigen,       RK_MATRIX,
+    OPF_REAL | OPF_STAGE },
+  { "eigenvalue",    0, monSquare,     RK_SQUARE, dyaEigen,       RK_MATRIX,
+    OPF_REAL | OPF_STAGE },
+  { "ident",         1, monIdent,      RK_SCALAR, nullptr,        0, 0 },
+  { "rotate",        1, monRotate,     RK_SCALAR | RK_VECTOR, nullptr, 0, 0 },
+  { "homogeneous",   1, nullptr,       0,         dyaHomogeneous, RK_VECTOR,
+    0 },
+  { "norm",          1, monNorm,       RK_ARRAY,  nullptr,        0,
+    OPF_REAL | OPF_STAGE },
+  { "grand",         1, monGaussian,   RK_ANY,    nullptr,        0, 0 },
+  { "print",         1, nullptr,       0,         dyaPrint,       RK_ANY,
+    OPF_TEXT },
+  { "Covariance",    1, monCovariance, RK_MATRIX, dyaCovariance,  RK_VECTOR,
+    OPF_REAL | OPF_CASE | OPF_STAGE },
+  { "logdet",        1, monSquare,     RK_ARRAY,  nullptr,        0,
+    OPF_REAL | OPF_STAGE },
+  { "solve",         1, nullptr,       0,         dyaSolve,       RK_MATRIX,
+    OPF_REAL },
+  { "inverse",       3, monSquare,     RK_SQUARE, nullptr,        0,
+    OPF_REAL | OPF_STAGE },
+  { "eigensystem",   0, monSquare,     RK_SQUARE, dyaEigen,       RK_MATRIX,
+    OPF_REAL | OPF_STAGE },
+  { "arena",         0, monArena,      RK_SCALAR, nullptr,        0, 0 },
+  { "threads",       0, monThreads,    RK_SCALAR, nullptr,        0, 0 },
+  { "seed",          0, monSeed,       RK_SCALAR, nullptr,        0, 0 },
+  { "mvn",           0, nullptr,       0,         dyaMvn,         RK_SCALAR,
+    OPF_REAL },
+  { "acc_open",      0, monAccOpen,    RK_SCALAR, nullptr,        0, 0 },
+  { "acc_add",       0, nullptr,       0,         dyaAccAdd,
+    RK_VECTOR | RK_MATRIX, OPF_REAL },
+  { "acc_merge",     0, nullptr,       0,         dyaAccMerge,    RK_SCALAR,
+    0 },
+  { "acc_cov",       0, monAccResult,  RK_SCALAR, nullptr,        0, 0 },
+  { "acc_corr",      0, monAccResult,  RK_SCALAR, nullptr,        0, 0 },
+  { "acc_close",     0, monAccClose,   RK_SCALAR, nullptr,        0, 0 },
+  { "rolling_cov",   0, nullptr,       0,         dyaRollingCov,  RK_MATRIX,
+    OPF_REAL },
+  { "pca",           0, monPca,        RK_MATRIX, dyaPca,         RK_MATRIX,
+    OPF_REAL },
+  { "svd",           0, nullptr,       0,         dyaSvd,         RK_MATRIX,
+    OPF_REAL },
+};
+
+static_assert (sizeof(opTable) / sizeof(opTable[0]) == OP_LAST,
+	       "opTable must have an entry for every op");
+
+static inline bool
+hasKernel (const OpEntry &e, bool dyadic)
+{
+  return dyadic ? (e.dyadic != nullptr) : (e.monadic != nullptr);
+}
+
+/***
+    The op named by an index string, OP_UNKNOWN if none.  The longest
+    match wins, so that 'inv' is inverse rather than ident.  The arity
+    plays no part, so that a name used the wrong way is reported by
+    checkOp () rather than matched to some other op with the same
+    initial.
+ ***/
+
+static int
+findOp (const char *which)
+{
+  int op = OP_UNKNOWN;
+  int op_len = 0;
+  for (int i = OP_UNKNOWN + 1; i < OP_LAST; i++) {
+    const OpEntry &e = opTable[i];
+    int len = e.prefix;
+    bool match;
+    if (len == 0) {
+      len = strlen (e.name);
+      match = !strcasecmp (which, e.name);
+    }
+    else if (e.flags & OPF_CASE)
+      match = !strncmp (which, e.name, len);
+    else
+      match = !strncasecmp (which, e.name, len);
+    if (match && len > op_len) {
+      op = i;
+      op_len = len;
+    }
+  }
+  return op;
+}
+
+/***
+    The registry entry for op, after checking that op is one, that it
+    has a kernel for the arity, and that it accepts B.
+ ***/
+
+static const OpEntry &
+checkOp (int op, Value_P B, bool dyadic)
+{
+  if (op <= OP_UNKNOWN || op >= OP_LAST) {
+    MORE_ERROR () << "Invalid mtx type specifoed";
+    SYNTAX_ERROR;
+  }
+  const OpEntry &e = opTable[op];
+  if (!hasKernel (e, dyadic)) {
+    MORE_ERROR () << (dyadic ? "Not a dyadic operation." :
+		      "Not a monadic operation.");
+    DOMAIN_ERROR;
+  }
+
+  const auto rank = B->get_rank ();
+  int ranks = dyadic ? e.dranks : e.mranks;
+  if (!(ranks & ((rank > 2) ? RK_STACK : (1 << rank)))) {
+    MORE_ERROR () << "Invalid argument rank for " << e.name << ".";
+    RANK_ERROR;
+  }
+  if (rank >= 2 && B->is_empty ()) {
+    MORE_ERROR () << "Null argument.";
+    LENGTH_ERROR;	
+  }
+  return e;
+}
+
+//https://misc.flogisoft.com/bash/tip_colors_and_formatting
+
+static inline void
+showHelpLine (int op)
+{
+  const OpEntry &e = opTable[op];
+  int len = e.prefix ? e.prefix : strlen (e.name);
+  const char *arity =
+    !e.monadic ? "dyadic" : (e.dyadic ? "monadic, dyadic" : "monadic");
+  char *str;
+  asprintf (&str, "\t%2d  \e[4m%.*s\e[0m%-*s%s", op,
+	    len, e.name, 16 - len, e.name + len, arity);
+  cout << str << endl;
+  free (str);
+}
+
+static void
+showHelp ()
+{
+  cout << "\n\tgeneral form: mtx['\e[3mindex\e[0m']\n\n";
+  cout << "\tvalid '\e[3mindex\e[0m' values: (underscored minimal)\n\n";
+  for (int op = OP_UNKNOWN + 1; op < OP_LAST; op++)
+    showHelpLine (op);
+  cout << "\n\tdefaults to determinant if the index is omitted.\n";
+  cout << "\tthe number of an op may be given instead of its name,\n";
+  cout << "\te.g. mtx[1] for determinant, which skips the name lookup.\n\n";
+  cout << "\tvector kernels: " << simdLevel () << "\n\n";
+}
+
+/***
+    Runs a pipeline such as 'C|eigensystem':  each stage, a monadic op,
+    is applied to the result of the one before it, left to right.  The
+    argument is read once and the intermediate results stay native, as
+    real matrices for as long as they're real; only the last is turned
+    into an APL value.
+ ***/
+
+static Value_P
+genPipeline (const char *which, Value_P B)
+{
+  const auto rank = B->get_rank ();
+  if (!(B->deep_cell_types () & CT_NUMERIC)) {
+    MORE_ERROR () << "Non-numeric argument.";
+    DOMAIN_ERROR;
+  }
+  if (rank > 2 || B->is_empty ()) {
+    MORE_ERROR () << "Pipelines take a scalar, vector, or matrix.";
+    RANK_ERROR;
+  }
+  int rows = (rank == 2) ? B->get_shape_item (0) : 1;
+  int cols = (rank == 0) ? 1 : B->get_shape_item (rank - 1);
+  const CellType celltype = B->deep_cell_types ();
+
+  Stage st;
+  if (celltype & CT_COMPLEX)
+    st = toStage (RavelView<complex<double>> (B, 0, rows, cols).matrix (),
+		  rank);
+  else
+    st = toStage (RavelView<double> (B, 0, rows, cols).matrix (), rank);
+
+  string stages (which);
+  size_t start = 0;
+  for (;;) {
+    size_t bar = stages.find ('|', start);
+    string name = stages.substr (start, bar - start);
+    int op = findOp (name.c_str ());
+    if (op == OP_UNKNOWN) {
+      MORE_ERROR () << "Invalid pipeline stage " << name;
+      SYNTAX_ERROR;
+    }
+    if (!(opTable[op].flags & OPF_STAGE)) {
+      MORE_ERROR () << opTable[op].name << " is not a pipeline stage.";
+      DOMAIN_ERROR;
+    }
+    int64_t idet;
+    if (start == 0 && op == OP_DETERMINANT && exactDet (B, celltype, idet)) {
+      if (bar == string::npos) return IntScalar (idet, LOC);
+      RMatrix *det = new RMatrix (1, 1);
+      det->val (0, 0, (double)idet);
+      st = toStage (det, 0);
+    }
+    else
+      st = st.rm ? runStage (op, st.rm, st.rank) :
+	runStage (op, st.cm, st.rank);
+    if (bar == string::npos) break;
+    start = bar + 1;
+  }
+
+  return st.rm ? genStageValue (st.rm, st.rank) : genStageValue (st.cm, st.rank);
+}
+
+static Token
+eval_XB(Value_P X, Value_P B, const NativeFunction * caller)
+{
+  ArenaScope scope;
+  
+  if (B->is_char_string ()) {
+    showHelp ();
+    return Token(TOK_APL_VALUE1, Str0(LOC));
+  }
+  
+  int op = OP_UNKNOWN;
+  
+  if (X->is_char_string ()) {
+    const UCS_string  ustr = X->get_UCS_ravel();
+    UTF8_string which (ustr);
+    if (strchr (which.c_str (), '|'))
+      return Token(TOK_APL_VALUE1, genPipeline (which.c_str (), B));
+    op = findOp (which.c_str ());
+  }
+  else if (X->is_numeric_scalar()) 	// the fast path
+    op = X->get_sole_integer ();
+
+  const OpEntry &e = checkOp (op, B, false);
+
+  CellType celltype = B->deep_cell_types();
+  if (!(celltype & CT_NUMERIC)) {
+    MORE_ERROR () << "Non-numeric argument.";
+    DOMAIN_ERROR;
+  }
+  if (!(e.flags & OPF_REAL)) celltype = CellType (celltype | CT_COMPLEX);
+
+  return Token(TOK_APL_VALUE1, e.monadic (op, B, celltype));
+}
+
+static Token
+eval_B(Value_P B, const NativeFunction * caller)
+{
+  Value_P X = IntScalar (OP_DETERMINANT, LOC);	// default to determinant
+  return eval_XB (X, B, caller);
+}
+
+static Token
+eval_AXB(Value_P A, Value_P X, Value_P B,
+	 const NativeFunction * caller)
+{
+  ArenaScope scope;
+  int op = OP_UNKNOWN;
+  
+  if (X->is_char_string ()) {
+    const UCS_string  ustr = X->get_UCS_ravel();
+    UTF8_string which (ustr);
+    if (strchr (which.c_str (), '|')) {
+      MORE_ERROR () << "Pipelines are monadic only.";
+      SYNTAX_ERROR;
+    }
+    op = findOp (which.c_str ());
+  }
+  else if (X->is_numeric_scalar()) 	// the fast path
+    op = X->get_sole_integer ();
+
+  const OpEntry &e = checkOp (op, B, true);
+
+  const CellType A_celltype = A->deep_cell_types();
+  const CellType B_celltype = B->deep_cell_types();
+  if (!(e.flags & OPF_TEXT) &&
+      !((A_celltype & CT_NUMERIC) && (B_celltype & CT_NUMERIC))) {
+    MORE_ERROR () << "Non-numeric argument.";
+    DOMAIN_ERROR;
+  }
+  CellType celltype = CellType (A_celltype | B_celltype);
+  if (!(e.flags & OPF_REAL)) celltype = CellType (celltype | CT_COMPLEX);
+
+  return Token(TOK_APL_VALUE1, e.dyadic (op, A, B, celltype));
+}
+
+static Token
+eval_AB(Value_P A, Value_P B, const NativeFunction * caller)
+{
+  Value_P X = IntScalar (OP_DETERMINANT, LOC);	// default to determinant
+  return eval_AXB (A, X, B, caller);
+}
+
+void *
+get_function_mux(const char * function_name)
+{
+  if (!gslcblas_lib)
+    gslcblas_lib = dlopen ("libgslcblas.so", RTLD_NOW | RTLD_GLOBAL);
+
+  if (!gsl_lib) {
+    gsl_lib = dlopen ("libgsl.so", RTLD_LAZY | RTLD_GLOBAL);
+    gsl_set_error_handler_off ();	// don't let gsl abort the interpreter
+    simdInit ();
+  }
   
   // mandatory
   if (!strcmp(function_name, "get_signature"))
@@ -1115,6 +2034,8 @@ get_function_mux(const char * function_name)
     return reinterpret_cast<void *>(&eval_ident_Bx);
 
   // ad hoc
+  if (!strcmp(function_name, "close_fun"))
+    return reinterpret_cast<void *>(&close_fun);
   if (!strcmp(function_name, "eval_B"))
     return reinterpret_cast<void *>(&eval_B);
   if (!strcmp(function_name, "eval_AB"))
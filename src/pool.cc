@@ -0,0 +1,179 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../mtx_config.h"
+
+#include<atomic>
+#include<condition_variable>
+#include<exception>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#undef PACKAGE
+#undef PACKAGE_BUGREPORT
+#undef PACKAGE_NAME
+#undef PACKAGE_STRING
+#undef PACKAGE_TARNAME
+#undef PACKAGE_URL
+#undef PACKAGE_VERSION
+#undef VERSION
+
+#include "arena.hh"
+#include "pool.hh"
+
+struct PoolJob
+{
+  const function<void (size_t)> *fn;
+  size_t          count;
+  atomic<size_t>  next;
+  int             active;
+  exception_ptr   error;
+  mutex           error_lock;
+};
+
+static mutex              call_lock;	// one parallelFor at a time
+static mutex              pool_lock;
+static condition_variable work_cv;
+static condition_variable done_cv;
+static vector<thread>     workers;
+static PoolJob           *job = nullptr;
+static unsigned long      job_gen = 0;
+static bool               stopping = false;
+static int                pool_size = 0;	// 0 means hardware threads
+
+static void
+runJob (PoolJob *j)
+{
+  size_t i;
+  while ((i = j->next++) < j->count) {
+    if (j->error) continue;
+    try {
+      ArenaScope scope;
+      (*j->fn) (i);
+    }
+    catch (...) {
+      lock_guard<mutex> guard (j->error_lock);
+      if (!j->error) j->error = current_exception ();
+    }
+  }
+}
+
+static void
+workerLoop ()
+{
+  unsigned long seen = job_gen;
+  Arena::set_worker ();
+  for (;;) {
+    unique_lock<mutex> lk (pool_lock);
+    work_cv.wait (lk, [&] { return stopping || (job && job_gen != seen); });
+    if (stopping) return;
+    seen = job_gen;
+    PoolJob *j = job;
+    j->active++;
+    lk.unlock ();
+    
+    runJob (j);
+    
+    lk.lock ();
+    if (--j->active == 0) done_cv.notify_all ();
+  }
+}
+
+static void
+stopWorkers ()
+{
+  {
+    lock_guard<mutex> guard (pool_lock);
+    stopping = true;
+  }
+  work_cv.notify_all ();
+  for (thread &t : workers) t.join ();
+  workers.clear ();
+  stopping = false;
+}
+
+void
+parallelFor (size_t count, const function<void (size_t)> &fn)
+{
+  lock_guard<mutex> call_guard (call_lock);
+
+  int threads = getPoolSize ();
+  if (count > 1 && threads > 1 && workers.size () != (size_t)(threads - 1)) {
+    stopWorkers ();
+    lock_guard<mutex> guard (pool_lock);
+    job_gen++;		// so new workers don't pick up a stale job
+    for (int t = 0; t < threads - 1; t++) workers.emplace_back (workerLoop);
+  }
+
+  PoolJob j;
+  j.fn     = &fn;
+  j.count  = count;
+  j.next   = 0;
+  j.active = 0;
+
+  if (count > 1 && threads > 1) {
+    {
+      lock_guard<mutex> guard (pool_lock);
+      job = &j;
+      job_gen++;
+    }
+    work_cv.notify_all ();
+    runJob (&j);
+    {
+      unique_lock<mutex> lk (pool_lock);
+      done_cv.wait (lk, [&] { return j.active == 0; });
+      job = nullptr;
+    }
+  }
+  else
+    runJob (&j);
+
+  if (j.error) {
+    try {
+      rethrow_exception (j.error);
+    }
+    catch (const ArenaFull &e) {
+      Arena::full (e);
+    }
+  }
+}
+
+int
+getPoolSize ()
+{
+  if (pool_size > 0) return pool_size;
+  int hw = thread::hardware_concurrency ();
+  return (hw > 0) ? hw : 1;
+}
+
+void
+setPoolSize (int threads)
+{
+  pool_size = (threads > 0) ? threads : 0;
+}
+
+void
+poolClose ()
+{
+  lock_guard<mutex> call_guard (call_lock);
+  stopWorkers ();
+}
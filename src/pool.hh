@@ -0,0 +1,44 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include<cstddef>
+#include<functional>
+
+using namespace std;
+
+/***
+    A persistent pool of worker threads for the batched (rank ≥ 3) ops.
+    parallelFor () calls fn (i) for every i in [0, count), spread across
+    the workers and the calling thread, and returns once all are done.
+    Each call of fn runs inside its own ArenaScope.  If any call throws,
+    the remaining items are skipped and the first exception is rethrown in
+    the calling thread, an ArenaFull from a worker as WS FULL.  fn must not itself call parallelFor ().
+
+    The pool size, which counts the calling thread, defaults to the
+    number of hardware threads and can be changed with mtx['threads'].
+ ***/
+
+void parallelFor (size_t count, const function<void (size_t)> &fn);
+int  getPoolSize ();
+void setPoolSize (int threads);
+void poolClose ();
@@ -0,0 +1,163 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include<complex>
+
+#include "Matrix.hh"
+
+/***
+    Needs the APL headers (Value.hh and friends) included first.
+ ***/
+
+using namespace std;
+
+/***
+    Cell values as T.  Matrix<double> is only used when the argument has
+    no complex cells, so the imaginary part is dropped there.
+ ***/
+
+static inline void
+cellValue (const Cell & Bv, double &v)
+{
+  v = Bv.get_real_value ();
+}
+
+static inline void
+cellValue (const Cell & Bv, complex<double> &v)
+{
+  v = complex<double> (Bv.get_real_value (),
+		       Bv.is_complex_cell () ? Bv.get_imag_value () : 0.0);
+}
+
+/***
+    A read-only, strided rows × cols window on the ravel of an APL value,
+    so that kernels read the cells where they are rather than through a
+    copy.  Element (r, c) is cell offset + r × rstride + c × cstride, so
+    the same view covers a whole matrix, one slice of a stack, or a single
+    row or column.  The view holds a reference to the value, and must only
+    be used on the interpreter's thread.
+ ***/
+
+template<typename T>
+class RavelView
+{
+public:
+  RavelView (Value_P B, ShapeItem offset, int r, int c)
+    : RavelView (B, offset, r, c, c, 1) {}
+  RavelView (Value_P B, ShapeItem offset, int r, int c,
+	     ShapeItem rs, ShapeItem cs)
+    : value (B), cells (&B->get_cfirst () + offset),
+      krows (r), kcols (c), rstride (rs), cstride (cs) {}
+
+  T val (int r, int c) const
+  {
+    T v;
+    cellValue (cells[r * rstride + c * cstride], v);
+    return v;
+  }
+  int rows () const { return krows; }
+  int cols () const { return kcols; }
+  void copy (T *dst) const	// dense, row-major
+  {
+    for (int r = 0; r < krows; r++) {
+      const Cell *row = cells + r * rstride;
+      for (int c = 0; c < kcols; c++) cellValue (row[c * cstride], *dst++);
+    }
+  }
+  Matrix<T> *matrix () const
+  {
+    Matrix<T> *mtx = new Matrix<T> (krows, kcols);
+    copy (mtx->data ());
+    return mtx;
+  }
+
+private:
+  Value_P     value;
+  const Cell *cells;
+  int         krows;
+  int         kcols;
+  ShapeItem   rstride;
+  ShapeItem   cstride;
+};
+
+/***
+    Writes a result straight into the ravel of the Value it returns.  The
+    Value is made flat, as APL wants before its cells are set, and gets
+    its real shape in get ().  put () writes the whole ravel at once from
+    a native buffer, as Float cells if every value is real and as Complex
+    ones otherwise, so that real results don't become complex arrays.
+ ***/
+
+class ResultBuilder
+{
+public:
+  ResultBuilder (const Shape & shape)
+    : shape_W (shape)
+  {
+    Shape shape_Z;
+    shape_Z.add_shape_item (shape.get_volume ());
+    rc = Value_P (shape_Z, LOC);
+  }
+
+  void set (ShapeItem i, APL_Integer v)     { (*rc).set_ravel_Int (i, v); }
+  void set (ShapeItem i, double v)          { (*rc).set_ravel_Float (i, v); }
+  void set (ShapeItem i, complex<double> v)
+  {
+    (*rc).set_ravel_Complex (i, v.real (), v.imag ());
+  }
+  void set (ShapeItem i, Value_P v)         { (*rc).set_ravel_Value (i, v); }
+
+  void put (const double *v)
+  {
+    const ShapeItem n = shape_W.get_volume ();
+    for (ShapeItem i = 0; i < n; i++) set (i, v[i]);
+  }
+  void put (const complex<double> *v)
+  {
+    const ShapeItem n = shape_W.get_volume ();
+    ShapeItem i = 0;
+    while (i < n && v[i].imag () == 0.0) i++;
+    if (i == n)
+      for (i = 0; i < n; i++) set (i, v[i].real ());
+    else
+      for (i = 0; i < n; i++) set (i, v[i]);
+  }
+
+  static Value_P scalar (complex<double> v)
+  {
+    return (v.imag () == 0.0) ?
+      FloatScalar (v.real (), LOC) :
+      ComplexScalar (v.real (), v.imag (), LOC);
+  }
+
+  Value_P get ()
+  {
+    rc->check_value (LOC);
+    (*rc).set_shape (shape_W);
+    return rc;
+  }
+
+private:
+  Shape   shape_W;
+  Value_P rc;
+};
@@ -0,0 +1,130 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../mtx_config.h"
+
+#include<atomic>
+#include<cmath>
+#include<mutex>
+
+#undef PACKAGE
+#undef PACKAGE_BUGREPORT
+#undef PACKAGE_NAME
+#undef PACKAGE_STRING
+#undef PACKAGE_TARNAME
+#undef PACKAGE_URL
+#undef PACKAGE_VERSION
+#undef VERSION
+
+#include "rng.hh"
+
+static mutex            seed_lock;
+static bool             seed_set = false;
+static uint64_t         seed;
+static atomic<uint64_t> seed_gen{0};	// bumped by every setSeed ()
+static atomic<unsigned> next_ordinal{0};
+static uint64_t         streams = 0;	// bulk draws since the seed was set
+
+static uint64_t
+currentSeed (uint64_t &gen)
+{
+  lock_guard<mutex> lock (seed_lock);
+  if (!seed_set) {
+    random_device rd;
+    seed = (((uint64_t)rd () << 32) | rd ()) >> 1;	// fits an APL integer
+    seed_set = true;
+  }
+  gen = seed_gen;
+  return seed;
+}
+
+mt19937_64 &
+rngEngine ()
+{
+  thread_local mt19937_64 engine;
+  thread_local uint64_t   engine_gen = UINT64_MAX;
+  thread_local unsigned   ordinal = next_ordinal++;
+
+  if (engine_gen != seed_gen) {
+    uint64_t gen;
+    uint64_t s = currentSeed (gen);
+    seed_seq seq { (uint32_t)s, (uint32_t)(s >> 32), (uint32_t)ordinal };
+    engine.seed (seq);
+    engine_gen = gen;
+  }
+  return engine;
+}
+
+uint64_t
+getSeed ()
+{
+  uint64_t gen;
+  return currentSeed (gen);
+}
+
+void
+setSeed (uint64_t s)
+{
+  lock_guard<mutex> lock (seed_lock);
+  seed = s;
+  seed_set = true;
+  seed_gen++;
+  streams = 0;
+}
+
+/***
+    The SplitMix64 finaliser, which scrambles a 64-bit counter well
+    enough that successive values pass as independent.
+ ***/
+
+static inline uint64_t
+mix64 (uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+uint64_t
+newStream ()
+{
+  uint64_t gen;
+  uint64_t s = currentSeed (gen);
+  lock_guard<mutex> lock (seed_lock);
+  return mix64 (s ^ mix64 (++streams));
+}
+
+void
+fillNormals (double *dst, size_t n, uint64_t stream, size_t start)
+{
+  const uint64_t golden = 0x9e3779b97f4a7c15ULL;
+  const double   two_pi = 2.0 * M_PI;
+  const double   ulp    = 1.0 / (double)(1ULL << 53);
+
+  for (size_t i = 0; i < n; i += 2) {
+    uint64_t ctr = stream + (start + i) * golden;
+    double u1 = ((mix64 (ctr + golden) >> 11) + 1) * ulp;	// (0, 1]
+    double u2 = (mix64 (ctr + 2 * golden) >> 11) * ulp;	// [0, 1)
+    double r  = sqrt (-2.0 * log (u1));
+    dst[i] = r * cos (two_pi * u2);
+    if (i + 1 < n) dst[i + 1] = r * sin (two_pi * u2);
+  }
+}
@@ -0,0 +1,53 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include<cstdint>
+#include<random>
+
+using namespace std;
+
+/***
+    One Mersenne Twister per thread, seeded once rather than per draw.
+    Each thread's engine is seeded from the current seed and the order
+    in which that thread first asked for one, and is reseeded whenever
+    the seed is set again, so setting the same seed replays the same
+    numbers.  Until mtx['seed'] sets one, the seed is taken once from the
+    system's entropy source and can be read back to replay a run.
+ ***/
+
+mt19937_64 &rngEngine ();
+uint64_t    getSeed ();
+void        setSeed (uint64_t seed);
+
+/***
+    Counter-based normals for filling large arrays in parallel.  Value i
+    of a stream is a function only of the stream's key and i, so a stream
+    can be filled in chunks, in any order, on any number of threads, and
+    come out the same.  newStream () gives the key for the next bulk
+    draw; the keys follow from the seed, so a seeded run replays.
+    fillNormals () fills dst with values start to start + n - 1 of the
+    stream, by Box-Muller on pairs, so start must be even.
+ ***/
+
+uint64_t newStream ();
+void     fillNormals (double *dst, size_t n, uint64_t stream, size_t start);
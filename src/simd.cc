@@ -0,0 +1,245 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../mtx_config.h"
+
+#undef PACKAGE
+#undef PACKAGE_BUGREPORT
+#undef PACKAGE_NAME
+#undef PACKAGE_STRING
+#undef PACKAGE_TARNAME
+#undef PACKAGE_URL
+#undef PACKAGE_VERSION
+#undef VERSION
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#include "simd.hh"
+
+struct SimdKernels
+{
+  const char *name;
+  double (*dot)   (const double *x, const double *y, size_t n);
+  void   (*scale) (double *x, double a, size_t n);
+  void   (*axpy)  (double a, const double *x, double *y, size_t n);
+  void   (*matvec)(const double *a, size_t rows, size_t cols,
+		   const double *x, double *y);
+};
+
+/***  scalar  ***/
+
+static double
+dotScalar (const double *x, const double *y, size_t n)
+{
+  double sum = 0.0;
+  for (size_t i = 0; i < n; i++) sum += x[i] * y[i];
+  return sum;
+}
+
+static void
+scaleScalar (double *x, double a, size_t n)
+{
+  for (size_t i = 0; i < n; i++) x[i] *= a;
+}
+
+static void
+axpyScalar (double a, const double *x, double *y, size_t n)
+{
+  for (size_t i = 0; i < n; i++) y[i] += a * x[i];
+}
+
+static void
+matvecScalar (const double *a, size_t rows, size_t cols,
+	      const double *x, double *y)
+{
+  for (size_t r = 0; r < rows; r++) y[r] = dotScalar (a + r * cols, x, cols);
+}
+
+static const SimdKernels scalarKernels =
+  { "scalar", dotScalar, scaleScalar, axpyScalar, matvecScalar };
+
+#ifdef HAVE_X86_SIMD
+
+/***  AVX2 + FMA, 4 doubles a register, two accumulators  ***/
+
+__attribute__((target("avx2,fma"))) static double
+dotAVX2 (const double *x, const double *y, size_t n)
+{
+  __m256d s0 = _mm256_setzero_pd ();
+  __m256d s1 = _mm256_setzero_pd ();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    s0 = _mm256_fmadd_pd (_mm256_loadu_pd (x + i),
+			  _mm256_loadu_pd (y + i), s0);
+    s1 = _mm256_fmadd_pd (_mm256_loadu_pd (x + i + 4),
+			  _mm256_loadu_pd (y + i + 4), s1);
+  }
+  s0 = _mm256_add_pd (s0, s1);
+  __m128d h = _mm_add_pd (_mm256_castpd256_pd128 (s0),
+			  _mm256_extractf128_pd (s0, 1));
+  double sum = _mm_cvtsd_f64 (_mm_add_sd (h, _mm_unpackhi_pd (h, h)));
+  for (; i < n; i++) sum += x[i] * y[i];
+  return sum;
+}
+
+__attribute__((target("avx2,fma"))) static void
+scaleAVX2 (double *x, double a, size_t n)
+{
+  __m256d va = _mm256_set1_pd (a);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd (x + i, _mm256_mul_pd (_mm256_loadu_pd (x + i), va));
+  for (; i < n; i++) x[i] *= a;
+}
+
+__attribute__((target("avx2,fma"))) static void
+axpyAVX2 (double a, const double *x, double *y, size_t n)
+{
+  __m256d va = _mm256_set1_pd (a);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm256_storeu_pd (y + i, _mm256_fmadd_pd (va, _mm256_loadu_pd (x + i),
+					      _mm256_loadu_pd (y + i)));
+  for (; i < n; i++) y[i] += a * x[i];
+}
+
+__attribute__((target("avx2,fma"))) static void
+matvecAVX2 (const double *a, size_t rows, size_t cols,
+	    const double *x, double *y)
+{
+  for (size_t r = 0; r < rows; r++) y[r] = dotAVX2 (a + r * cols, x, cols);
+}
+
+static const SimdKernels avx2Kernels =
+  { "avx2", dotAVX2, scaleAVX2, axpyAVX2, matvecAVX2 };
+
+/***  AVX-512F, 8 doubles a register, masked tails  ***/
+
+__attribute__((target("avx512f"))) static double
+dotAVX512 (const double *x, const double *y, size_t n)
+{
+  __m512d s0 = _mm512_setzero_pd ();
+  __m512d s1 = _mm512_setzero_pd ();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    s0 = _mm512_fmadd_pd (_mm512_loadu_pd (x + i),
+			  _mm512_loadu_pd (y + i), s0);
+    s1 = _mm512_fmadd_pd (_mm512_loadu_pd (x + i + 8),
+			  _mm512_loadu_pd (y + i + 8), s1);
+  }
+  for (; i < n; i += 8) {
+    __mmask8 m = (n - i >= 8) ? 0xff : (__mmask8)((1u << (n - i)) - 1);
+    s0 = _mm512_fmadd_pd (_mm512_maskz_loadu_pd (m, x + i),
+			  _mm512_maskz_loadu_pd (m, y + i), s0);
+  }
+  double t[8];
+  _mm512_storeu_pd (t, _mm512_add_pd (s0, s1));
+  return ((t[0] + t[1]) + (t[2] + t[3])) + ((t[4] + t[5]) + (t[6] + t[7]));
+}
+
+__attribute__((target("avx512f"))) static void
+scaleAVX512 (double *x, double a, size_t n)
+{
+  __m512d va = _mm512_set1_pd (a);
+  for (size_t i = 0; i < n; i += 8) {
+    __mmask8 m = (n - i >= 8) ? 0xff : (__mmask8)((1u << (n - i)) - 1);
+    _mm512_mask_storeu_pd (x + i, m,
+			   _mm512_mul_pd (_mm512_maskz_loadu_pd (m, x + i), va));
+  }
+}
+
+__attribute__((target("avx512f"))) static void
+axpyAVX512 (double a, const double *x, double *y, size_t n)
+{
+  __m512d va = _mm512_set1_pd (a);
+  for (size_t i = 0; i < n; i += 8) {
+    __mmask8 m = (n - i >= 8) ? 0xff : (__mmask8)((1u << (n - i)) - 1);
+    __m512d r = _mm512_fmadd_pd (va, _mm512_maskz_loadu_pd (m, x + i),
+				 _mm512_maskz_loadu_pd (m, y + i));
+    _mm512_mask_storeu_pd (y + i, m, r);
+  }
+}
+
+__attribute__((target("avx512f"))) static void
+matvecAVX512 (const double *a, size_t rows, size_t cols,
+	      const double *x, double *y)
+{
+  for (size_t r = 0; r < rows; r++) y[r] = dotAVX512 (a + r * cols, x, cols);
+}
+
+static const SimdKernels avx512Kernels =
+  { "avx512", dotAVX512, scaleAVX512, axpyAVX512, matvecAVX512 };
+
+#endif
+
+static const SimdKernels *kernels = &scalarKernels;
+
+void
+simdInit ()
+{
+#ifdef HAVE_X86_SIMD
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx512f"))
+    kernels = &avx512Kernels;
+  else if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma"))
+    kernels = &avx2Kernels;
+#endif
+}
+
+const char *
+simdLevel ()
+{
+  return kernels->name;
+}
+
+double
+vecDot (const double *x, const double *y, size_t n)
+{
+  return kernels->dot (x, y, n);
+}
+
+double
+vecSumSq (const double *x, size_t n)
+{
+  return kernels->dot (x, x, n);
+}
+
+void
+vecScale (double *x, double a, size_t n)
+{
+  kernels->scale (x, a, n);
+}
+
+void
+vecAxpy (double a, const double *x, double *y, size_t n)
+{
+  kernels->axpy (a, x, y, n);
+}
+
+void
+denseMatVec (const double *a, size_t rows, size_t cols,
+	     const double *x, double *y)
+{
+  kernels->matvec (a, rows, cols, x, y);
+}
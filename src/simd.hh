@@ -0,0 +1,42 @@
+
+/*
+    This file is part of GNU APL, a free implementation of the
+    ISO/IEC Standard 13751, "Programming Language APL, Extended"
+
+    mtx Copyright (C) 2024  Dr. C. H. L. Moller
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include<cstddef>
+
+/***
+    Vector kernels on plain double arrays.  AVX-512 and AVX2 versions are
+    built alongside the scalar ones and the best the CPU supports is picked
+    by simdInit () when the library is loaded; until then, and on other
+    architectures, the scalar ones are used.  Complex data in the usual
+    interleaved layout can go through vecScale () as 2n doubles.
+ ***/
+
+void        simdInit ();
+const char *simdLevel ();
+
+double vecDot (const double *x, const double *y, size_t n);
+double vecSumSq (const double *x, size_t n);
+void   vecScale (double *x, double a, size_t n);
+void   vecAxpy (double a, const double *x, double *y, size_t n);
+void   denseMatVec (const double *a, size_t rows, size_t cols,
+		    const double *x, double *y);	// a row-major